@@ -1,9 +1,12 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <fcntl.h>
+#include <getopt.h>
 #include <limits.h>
+#include <poll.h>
 #include <unistd.h>
 
 
@@ -11,6 +14,7 @@
 
 #include "msg.h"
 #include "burst_queue.h"
+#include "shm.h"
 
 /**
  * Extracts the basename of a file without its extension.
@@ -32,78 +36,246 @@ char *get_basename_no_ext(const char* path) {
     return result;
 }
 
-typedef enum {
-    process_error = 0,
-    process_success,
-    process_terminated
-} process_status_en;
-
-process_status_en handle_process_requests(int sockfd, const pid_t pid, const char *app_name, burst_t *burst, process_request_t request, uint32_t *sim_start_time_ms, uint32_t *sim_clock_ms) {
-    msg_t msg = {
-        .pid = pid,
-        .request = request,
-        .time_ms = (request == PROCESS_REQUEST_RUN)?burst->burst_time_ms:burst->block_time_ms
-    };
-    // Send request
-    if (write(sockfd, &msg, sizeof(msg_t)) != sizeof(msg_t)) {
-        perror("write");
-        close(sockfd);
-        return process_error;
+// Requests sent ahead of their DONE, more are sent when half of them are DONE
+#define PIPELINE_DEPTH 8
+
+// The messages of the application: a HELLO, then the requests, each RUN preceded by its pages
+typedef struct {
+    msg_t *msgs;
+    uint32_t *first_msg;        // Index of the first message of each request, and of the end
+    uint32_t n_requests;
+} requests_t;
+
+/**
+ * @brief The message of a request (its RUN or BLOCK, after its PAGEs)
+ */
+static const msg_t *request_msg(const requests_t *requests, uint32_t request) {
+    return &requests->msgs[requests->first_msg[request + 1] - 1];
+}
+
+/**
+ * @brief Turn the bursts into the requests of the application, after a HELLO
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int build_requests(requests_t *requests, const burst_array_t *bursts, const pid_t pid, uint32_t version) {
+    // At most a RUN and a BLOCK per burst, and the pages of the RUN
+    size_t n_msgs = 1 + 2 * (size_t) bursts->count;
+    for (uint32_t i = 0; i < bursts->count; i++) n_msgs += bursts->bursts[i].n_pages;
+    requests->msgs = malloc(n_msgs * sizeof(msg_t));
+    requests->first_msg = malloc((1 + 2 * (size_t) bursts->count) * sizeof(uint32_t));
+    if (!requests->msgs || !requests->first_msg) {
+        free(requests->msgs);
+        free(requests->first_msg);
+        return -1;
     }
-    DBG("Application %s (PID %d) sent %s request for %u ms",
-           app_name, pid, PROCESS_REQUEST_STRINGS[request], msg.time_ms);
-    // Wait for ACK and the internal simulation time
-    if (read(sockfd, &msg, sizeof(msg_t)) != sizeof(msg_t)) {
-        perror("read");
-        close(sockfd);
-        return process_error;
+    msg_t *msgs = requests->msgs;
+    msgs[0] = (msg_t) {.pid = pid, .request = PROCESS_REQUEST_HELLO, .time_ms = version};
+    uint32_t n = 1;
+    uint32_t r = 0;
+    for (uint32_t i = 0; i < bursts->count; i++) {
+        const burst_t *burst = &bursts->bursts[i];
+        const uint32_t *pages = burst_pages(bursts, burst);
+        requests->first_msg[r++] = n;
+        for (uint32_t p = 0; p < burst->n_pages; p++) {
+            msgs[n++] = (msg_t) {.pid = pid, .request = PROCESS_REQUEST_PAGE, .time_ms = pages[p]};
+        }
+        msgs[n++] = (msg_t) {.pid = pid, .request = PROCESS_REQUEST_RUN, .time_ms = burst->burst_time_ms,
+                             .nice = burst->nice};
+        if (burst->block_time_ms > 0) {
+            requests->first_msg[r++] = n;
+            msgs[n++] = (msg_t) {.pid = pid, .request = PROCESS_REQUEST_BLOCK, .time_ms = burst->block_time_ms};
+        }
     }
-    if (msg.request != PROCESS_REQUEST_ACK) {
-        printf("Received invalid request. Expected ACK, received %s\n", PROCESS_REQUEST_STRINGS[msg.request]);
-        return process_error;
+    requests->first_msg[r] = n;
+    requests->n_requests = r;
+    return 0;
+}
+
+// How the messages travel: the socket, or the rings of a shared-memory channel
+typedef struct {
+    int sockfd;
+    shm_channel_t *channel;     // NULL if the socket is used
+    int request_efd;            // Signalled when the scheduler may be waiting for requests
+    int reply_efd;              // Signalled by the scheduler when it had no replies pending
+} transport_t;
+
+/**
+ * @brief Offer a shared-memory channel to the scheduler with the HELLO and wait for the answer
+ *
+ * @return The protocol version of the scheduler, -1 on failure. The channel is only used
+ *         if it is at least MSG_PROTOCOL_SHM_VERSION, otherwise it is released.
+ */
+static int open_channel(transport_t *transport, const msg_t *hello) {
+    int fds[SHM_FD_COUNT];
+    shm_channel_t *channel = shm_channel_create(fds);
+    if (!channel) {
+        perror("shm_channel_create");
+        return -1;
+    }
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {.iov_base = (void *) hello, .iov_len = sizeof(msg_t)};
+    struct msghdr header = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf)
+    };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&header);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+    msg_t answer;
+    int version = -1;
+    if (sendmsg(transport->sockfd, &header, 0) != sizeof(msg_t)) {
+        perror("sendmsg");
+    } else if (read(transport->sockfd, &answer, sizeof(msg_t)) != sizeof(msg_t) ||
+               answer.request != PROCESS_REQUEST_HELLO) {
+        printf("The scheduler did not answer the HELLO\n");
+    } else {
+        version = (int) answer.time_ms;
+    }
+    close(fds[SHM_FD_MEMORY]);  // The mapping keeps the memory
+    if (version >= MSG_PROTOCOL_SHM_VERSION) {
+        transport->channel = channel;
+        transport->request_efd = fds[SHM_FD_REQUESTS];
+        transport->reply_efd = fds[SHM_FD_REPLIES];
+    } else {
+        shm_channel_unmap(channel);
+        close(fds[SHM_FD_REQUESTS]);
+        close(fds[SHM_FD_REPLIES]);
     }
-    *sim_clock_ms = msg.time_ms;
-    if (*sim_start_time_ms == 0) *sim_start_time_ms = *sim_clock_ms; // First burst, set the start time
-    DBG("Received %s from scheduler for application %s (PID %d) at time %u ms\n",
-           PROCESS_REQUEST_STRINGS[msg.request], app_name, pid, *sim_clock_ms);
+    return version;
+}
 
-    // Wait for DONE and the internal simulation time
-    if (read(sockfd, &msg, sizeof(msg_t)) != sizeof(msg_t)) {
-        perror("read");
-        close(sockfd);
-        return process_error;
+/**
+ * @brief Send messages to the scheduler
+ *
+ * @return The number of messages sent, -1 on failure
+ */
+static int transport_send(transport_t *transport, const msg_t *msgs, uint32_t count) {
+    if (!transport->channel) {
+        size_t size = count * sizeof(msg_t);
+        if (write(transport->sockfd, msgs, size) != (ssize_t) size) {
+            perror("write");
+            return -1;
+        }
+        return (int) count;
     }
+    int wake;
+    uint32_t pushed = shm_ring_push(&transport->channel->requests, msgs, count, &wake);
+    uint64_t one = 1;
+    if (wake && write(transport->request_efd, &one, sizeof(one)) != sizeof(one)) {
+        perror("write: eventfd");
+        return -1;
+    }
+    return (int) pushed;
+}
 
-    if (msg.request != PROCESS_REQUEST_DONE) {
-        printf("Received invalid request. Expected DONE, received %s\n", PROCESS_REQUEST_STRINGS[msg.request]);
-        return process_error;
+/**
+ * @brief Receive the messages sent by the scheduler, waiting for at least one byte
+ *
+ * @return The number of bytes received, 0 if the scheduler closed the connection, -1 on failure
+ */
+static ssize_t transport_receive(transport_t *transport, void *buf, size_t size) {
+    if (!transport->channel) {
+        return read(transport->sockfd, buf, size);
+    }
+    while (1) {
+        uint32_t popped = shm_ring_pop(&transport->channel->replies, buf, (uint32_t) (size / sizeof(msg_t)));
+        if (popped > 0) return (ssize_t) (popped * sizeof(msg_t));
+        // The ring is empty, sleep until the scheduler signals or goes away
+        struct pollfd fds[2] = {
+            {.fd = transport->reply_efd, .events = POLLIN},
+            {.fd = transport->sockfd, .events = POLLRDHUP}
+        };
+        if (poll(fds, 2, -1) < 0) {
+            perror("poll");
+            return -1;
+        }
+        if (fds[1].revents & (POLLRDHUP | POLLHUP | POLLERR)) {
+            // Take what it sent before leaving
+            popped = shm_ring_pop(&transport->channel->replies, buf, (uint32_t) (size / sizeof(msg_t)));
+            return (ssize_t) (popped * sizeof(msg_t));
+        }
+        uint64_t count;
+        if (fds[0].revents & POLLIN) {
+            // Reset the counter, the ring tells what is pending
+            if (read(transport->reply_efd, &count, sizeof(count)) < 0) {
+                perror("read: eventfd");
+                return -1;
+            }
+        }
     }
-    *sim_clock_ms = msg.time_ms;
-    DBG("Received %s from scheduler for application %s (PID %d) at time %u ms\n",
-           PROCESS_REQUEST_STRINGS[msg.request], app_name, pid, *sim_clock_ms);
+}
+
+/**
+ * @brief Send the next requests at once, up to PIPELINE_DEPTH of them not DONE yet
+ *
+ * @param sent Number of messages already sent (the HELLO is the first one), updated
+ * @param done Number of requests DONE
+ */
+static int send_requests(transport_t *transport, const requests_t *requests, uint32_t *sent, uint32_t done) {
+    uint32_t last = done + PIPELINE_DEPTH;
+    if (last > requests->n_requests) last = requests->n_requests;
+    uint32_t end = requests->first_msg[last];
+    if (end <= *sent) return 0;
+    int n = transport_send(transport, &requests->msgs[*sent], end - *sent);
+    if (n < 0) return -1;
+    *sent += (uint32_t) n;
+    return 0;
+}
 
-    return process_success;
+/**
+ * @brief Number of requests whose message was sent
+ */
+static uint32_t requests_sent(const requests_t *requests, uint32_t sent) {
+    uint32_t count = 0;
+    while (count < requests->n_requests && requests->first_msg[count + 1] <= sent) count++;
+    return count;
 }
 
 /*
- * Run like: ./app-pre <burst-file.csv>
+ * Run like: ./app-pre <burst-file>
  */
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s <burst-file.csv>\n", argv[0]);
+    // Parse arguments
+    int use_shm = 0;
+    static const struct option long_options[] = {
+        {"shm", no_argument, NULL, 's'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s", long_options, NULL)) != -1) {
+        if (opt != 's') exit(EXIT_FAILURE);
+        use_shm = 1;
+    }
+    if (argc - optind != 1) {
+        printf("Usage: %s [--shm] <burst-file>\n", argv[0]);
         exit(EXIT_FAILURE);
     }
-
-    // Parse arguments
-    const char *burstfile_name = argv[1];
+    const char *burstfile_name = argv[optind];
     char *app_name = get_basename_no_ext(burstfile_name);
 
-    burst_queue_t bursts = {.head = NULL, .tail = NULL};
-
-    if (read_queue_from_file(&bursts, burstfile_name) <= 0) {
+    // CSV or compiled burst file (see burstc)
+    burst_array_t bursts;
+    if (load_bursts(&bursts, burstfile_name) <= 0) {
         fprintf(stderr, "Failed to read burst file %s\n", burstfile_name);
         return EXIT_FAILURE;
     }
+    pid_t pid = getpid();
+    requests_t requests;
+    int built = build_requests(&requests, &bursts, pid,
+                               use_shm ? MSG_PROTOCOL_SHM_VERSION : MSG_PROTOCOL_PIPELINE_VERSION);
+    free_bursts(&bursts);
+    if (built < 0) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
 
     // Setup socket for communication
     int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -122,24 +294,82 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    pid_t pid = getpid();
     uint32_t sim_clock_ms = 0;              // Clock of the scheduler
 
-    uint32_t start_time_ms = 0;             // Start time of the app
+    uint32_t start_time_ms = UINT32_MAX;    // Start time of the app (unset until the first ACK)
     uint32_t cpu_duration_ms = 0;           // duration of the app (bursts and blocks)
     uint32_t block_duration_ms = 0;         // duration of the app in blocked state
 
-    burst_t *active_burst;
-
-    while ((active_burst = dequeue_burst(&bursts)) != NULL) {
-        if (handle_process_requests(sockfd, pid, app_name, active_burst, PROCESS_REQUEST_RUN, &start_time_ms, &sim_clock_ms) == process_error)
+    transport_t transport = {.sockfd = sockfd, .channel = NULL, .request_efd = -1, .reply_efd = -1};
+    uint32_t sent = 0;                      // Messages sent (the first one is the HELLO)
+    if (use_shm) {
+        // The channel is only used once the scheduler accepted it, the socket is the fallback
+        int version = open_channel(&transport, &requests.msgs[0]);
+        if (version < 0) {
+            close(sockfd);
+            return EXIT_FAILURE;
+        }
+        if (!transport.channel) {
+            printf("The scheduler speaks protocol version %d, using the socket\n", version);
+        }
+        sent = 1;
+    }
+    // Otherwise the HELLO goes with the first requests, we do not wait for its answer
+    uint32_t acked = 0;                     // Requests acknowledged
+    uint32_t done = 0;                      // Requests DONE
+    msg_t inbox[MSG_BATCH_MAX];
+    size_t inbox_bytes = 0;
+    int failed = send_requests(&transport, &requests, &sent, done) < 0;
+    while (!failed && done < requests.n_requests) {
+        // Take whatever the scheduler flushed, usually the DONE of a request with the ACK of the next one
+        ssize_t n = transport_receive(&transport, (char *) inbox + inbox_bytes, sizeof(inbox) - inbox_bytes);
+        if (n <= 0) {
+            if (n < 0) perror("read");
+            else printf("Connection closed by the scheduler\n");
             break;
-        cpu_duration_ms += active_burst->burst_time_ms;
-
-        if (active_burst->block_time_ms > 0) {
-            if (handle_process_requests(sockfd, pid, app_name, active_burst, PROCESS_REQUEST_BLOCK, &start_time_ms, &sim_clock_ms) == process_error)
+        }
+        inbox_bytes += n;
+        uint32_t count = inbox_bytes / sizeof(msg_t);
+        for (uint32_t i = 0; i < count && !failed && done < requests.n_requests; i++) {
+            const msg_t *msg = &inbox[i];
+            const msg_t *request = request_msg(&requests, done);
+            if (msg->request == PROCESS_REQUEST_HELLO) {
+                if (msg->time_ms < MSG_PROTOCOL_PIPELINE_VERSION) {
+                    printf("The scheduler speaks protocol version %u, version %d is required\n", msg->time_ms,
+                           MSG_PROTOCOL_PIPELINE_VERSION);
+                    failed = 1;
+                }
+                continue;
+            }
+            process_request_t expected = (acked == done) ? PROCESS_REQUEST_ACK : PROCESS_REQUEST_DONE;
+            if (msg->request != expected) {
+                printf("Received invalid request. Expected %s, received %s\n",
+                       PROCESS_REQUEST_STRINGS[expected], PROCESS_REQUEST_STRINGS[msg->request]);
+                failed = 1;
                 break;
-            block_duration_ms += active_burst->block_time_ms;
+            }
+            sim_clock_ms = msg->time_ms;
+            if (msg->request == PROCESS_REQUEST_ACK) {
+                if (start_time_ms == UINT32_MAX) start_time_ms = sim_clock_ms; // First burst, set the start time
+                acked++;
+            } else {
+                if (request->request == PROCESS_REQUEST_RUN) {
+                    cpu_duration_ms += request->time_ms;
+                } else {
+                    block_duration_ms += request->time_ms;
+                }
+                done++;
+            }
+            DBG("Received %s of %s for %u ms from scheduler for application %s (PID %d) at time %u ms\n",
+                PROCESS_REQUEST_STRINGS[msg->request], PROCESS_REQUEST_STRINGS[request->request],
+                request->time_ms, app_name, pid, sim_clock_ms);
+        }
+        // Keep an incomplete message for the next read
+        inbox_bytes -= count * sizeof(msg_t);
+        memmove(inbox, &inbox[count], inbox_bytes);
+
+        if (!failed && requests_sent(&requests, sent) - done <= PIPELINE_DEPTH / 2) {
+            failed = send_requests(&transport, &requests, &sent, done) < 0;
         }
     }
 
@@ -151,7 +381,14 @@ int main(int argc, char *argv[]) {
     printf("Application %s (PID %d) finished at time %d ms, Elapsed: %.03f seconds, CPU: %.03f seconds, BLOCKED: %.03f seconds\n",
            app_name, pid, sim_clock_ms, real, user, sys);
 
+    if (transport.channel) {
+        shm_channel_unmap(transport.channel);
+        close(transport.request_efd);
+        close(transport.reply_efd);
+    }
     close(sockfd);
+    free(requests.msgs);
+    free(requests.first_msg);
     free(app_name);
     return EXIT_SUCCESS;
 }
\ No newline at end of file
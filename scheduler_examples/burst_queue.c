@@ -3,154 +3,237 @@
 
 #include "burst_queue.h"
 
+#include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#define MAX_LINE_LEN 1024
+static const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
 
-int parse_burst_line(const char* line, burst_t* burst) {
-    if (!line || !burst) return -1;
+/**
+ * @brief Parse a decimal integer in [*p, end), leading blanks allowed, and move *p past it
+ *
+ * @return 0 on success, -1 if there is no number or it does not fit between min and max
+ */
+static int scan_number(const char **p, const char *end, long min, long max, long *value) {
+    const char *s = skip_blanks(*p, end);
+    int negative = 0;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        ++s;
+    }
+    if (s == end || !isdigit((unsigned char) *s)) return -1;
+    long v = 0;
+    while (s < end && isdigit((unsigned char) *s)) {
+        if (v > (LONG_MAX - 9) / 10) return -1;
+        v = v * 10 + (*s - '0');
+        ++s;
+    }
+    if (negative) v = -v;
+    if (v < min || v > max) return -1;
+    *value = v;
+    *p = skip_blanks(s, end);
+    return 0;
+}
 
-    char* line_copy = strdup(line);
-    if (!line_copy) return -1;
+/**
+ * @brief Parse the line [p, end), without copying it
+ *
+ * @param pages Receives the pages, room for MAX_PAGES
+ */
+static int parse_burst_range(const char *p, const char *end, burst_t *burst, uint32_t *pages) {
+    long value;
+    *burst = (burst_t) {0};
 
-    char* endptr;
-    char* token = strtok(line_copy, ",");
+    // Required burst_time_ms
+    if (scan_number(&p, end, 0, INT_MAX, &value) < 0) return -1;
+    burst->burst_time_ms = (uint32_t) value;
 
-    // Parse required burst_time_ms
-    if (!token) {
-        fprintf(stderr, "Missing burst time\n");
-        free(line_copy);
-        return -1;
+    // Optional: block time
+    if (p == end || *p != ',') return 0;
+    ++p;
+    if (scan_number(&p, end, 0, INT_MAX, &value) < 0) return -1;
+    burst->block_time_ms = (uint32_t) value;
+
+    // Optional: nice
+    if (p == end || *p != ',') return 0;
+    ++p;
+    if (scan_number(&p, end, INT_MIN, INT_MAX, &value) < 0) return -1;
+    burst->nice = (int32_t) value;
+
+    // Optional: pages list
+    if (p == end || *p != ',') return 0;
+    p = skip_blanks(p + 1, end);
+    if (p == end || *p != '[') return 0;
+    ++p;
+    while (scan_number(&p, end, 0, INT_MAX, &value) == 0) {
+        if (burst->n_pages < MAX_PAGES) {
+            pages[burst->n_pages++] = (uint32_t) value;
+        }
+        if (p == end || *p != ',') break;
+        ++p;
     }
+    return (p < end && *p == ']') ? 0 : -1;
+}
 
-    long burst_time = strtol(token, &endptr, 10);
-    if (*endptr != '\0' || burst_time < 0 || burst_time > INT_MAX) {
-        fprintf(stderr, "Invalid burst time: %s\n", token);
-        free(line_copy);
-        return -1;
-    }
-    burst->burst_time_ms = (int)burst_time;
+int parse_burst_line(const char* line, burst_t* burst, uint32_t *pages) {
+    if (!line || !burst || !pages) return -1;
+    return parse_burst_range(line, line + strcspn(line, "\r\n"), burst, pages);
+}
 
-    // Optional: block time
-    token = strtok(NULL, ",\r\n");
-    if (token) {
-        long block_time_ms = strtol(token, &endptr, 10);
-        if (*endptr != '\0' || block_time_ms < INT_MIN || block_time_ms > INT_MAX) {
-            fprintf(stderr, "Invalid block time value: %s\n", token);
-            free(line_copy);
-            return -1;
-        }
-        burst->block_time_ms = (int)block_time_ms;
+/**
+ * @brief Make room for at least `needed` elements in a growable array
+ *
+ * @return 0 on success, -1 if the allocation failed
+ */
+static int reserve(void **items, uint32_t *capacity, uint32_t needed, size_t item_size, uint32_t initial) {
+    if (needed <= *capacity) return 0;
+    uint32_t grown_capacity = *capacity ? *capacity : initial;
+    while (grown_capacity < needed) {
+        if (grown_capacity > UINT32_MAX / 2) return -1;
+        grown_capacity *= 2;
     }
+    void *grown = realloc(*items, (size_t) grown_capacity * item_size);
+    if (!grown) return -1;
+    *items = grown;
+    *capacity = grown_capacity;
+    return 0;
+}
 
-    // Optional: parse nice
-    token = strtok(NULL, ",\r\n");
-    if (token) {
-        long nice_value = strtol(token, &endptr, 10);
-        if (*endptr != '\0' || nice_value < INT_MIN || nice_value > INT_MAX) {
-            fprintf(stderr, "Invalid nice value: %s\n", token);
-            free(line_copy);
+/**
+ * @brief Parse a CSV burst file from memory in a single pass
+ */
+static int parse_bursts(burst_array_t *array, const char *data, size_t size) {
+    uint32_t capacity = 0;
+    uint32_t pages_capacity = 0;
+    uint32_t line_number = 0;
+    const char *end = data + size;
+    const char *p = data;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t) (end - p));
+        if (!eol) eol = end;
+        const char *line = p;
+        p = eol + 1;
+        line_number++;
+
+        // Trim leading whitespace and the carriage return
+        while (line < eol && isspace((unsigned char) *line)) ++line;
+        const char *line_end = (eol > line && eol[-1] == '\r') ? eol - 1 : eol;
+        if (line == line_end || *line == '#') continue;
+
+        if (reserve((void **) &array->bursts, &capacity, array->count + 1, sizeof(burst_t), 1024) < 0 ||
+            reserve((void **) &array->pages, &pages_capacity, array->n_pages + MAX_PAGES, sizeof(uint32_t), 1024) < 0) {
+            fprintf(stderr, "Allocation of %u bursts failed\n", array->count + 1);
             return -1;
         }
-        burst->nice = (int)nice_value;
-    }
-
-
-    // Optional: parse pages list
-    burst->pages.count = 0;
-    token = strtok(NULL, "[");
-    if (token) token = strtok(NULL, "]");
-    if (token) {
-        char* page_token = strtok(token, ",");
-        while (page_token &&  burst->pages.count< MAX_PAGES) {
-            long page = strtol(page_token, &endptr, 10);
-            if (*endptr != '\0' || page < 0 || page > INT_MAX) {
-                fprintf(stderr, "Invalid page number: %s\n", page_token);
-                free(line_copy);
-                return -1;
-            }
-            burst->pages.ids[burst->pages.count++] = (int)page;
-            page_token = strtok(NULL, ",");
+        burst_t *burst = &array->bursts[array->count];
+        if (parse_burst_range(line, line_end, burst, array->pages + array->n_pages) == 0) {
+            burst->first_page = array->n_pages;
+            array->n_pages += burst->n_pages;
+            array->count++;
+        } else {
+            fprintf(stderr, "Skipping malformed line %u: %.*s\n", line_number, (int) (line_end - line), line);
         }
     }
-
-    free(line_copy);
     return 0;
 }
 
-
-int read_queue_from_file(burst_queue_t* queue, const char* filename) {
-    if (!queue || !filename) return -1;
-
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("fopen");
+int load_bursts(burst_array_t *array, const char *filename) {
+    *array = (burst_array_t) {0};
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(filename);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror(filename);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t) st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
         return -1;
     }
 
-    char line[MAX_LINE_LEN];
-    int success_count = 0;
-
-    while (fgets(line, sizeof(line), file)) {
-        // Trim leading whitespace
-        char* trimmed = line;
-        while (isspace(*trimmed)) ++trimmed;
-
-        if (*trimmed == '#' || *trimmed == '\0') continue;
-
-        burst_t burst = {0}; // Initialize burst structure
-        if (parse_burst_line(trimmed, &burst) == 0) {
-            if (enqueue_burst(queue, &burst)) {
-                success_count++;
-            } else {
-                fprintf(stderr, "Queue full or allocation failed\n");
-                break;
+    const burst_file_header_t *header = map;
+    if (size >= sizeof(burst_file_header_t) &&
+        memcmp(header->magic, BURST_FILE_MAGIC, sizeof(header->magic)) == 0) {
+        if (header->version != BURST_FILE_VERSION || header->record_size != sizeof(burst_t) ||
+            header->count > UINT32_MAX || header->n_pages > UINT32_MAX ||
+            size < sizeof(burst_file_header_t) + header->count * sizeof(burst_t) + header->n_pages * sizeof(uint32_t)) {
+            fprintf(stderr, "%s: not a burst file of version %d for this build\n", filename, BURST_FILE_VERSION);
+            munmap(map, size);
+            return -1;
+        }
+        // Used in place, the records are never written
+        array->bursts = (burst_t *) (header + 1);
+        array->count = (uint32_t) header->count;
+        array->pages = (uint32_t *) (array->bursts + array->count);
+        array->n_pages = (uint32_t) header->n_pages;
+        for (uint32_t i = 0; i < array->count; i++) {
+            const burst_t *burst = &array->bursts[i];
+            if (burst->n_pages > array->n_pages || burst->first_page > array->n_pages - burst->n_pages) {
+                fprintf(stderr, "%s: burst %u has pages out of the file\n", filename, i);
+                munmap(map, size);
+                *array = (burst_array_t) {0};
+                return -1;
             }
-        } else {
-            fprintf(stderr, "Skipping malformed line: %s", line);
         }
+        array->map = map;
+        array->map_size = size;
+        return (int) array->count;
     }
 
-    fclose(file);
-    return success_count;
-}
-
-
-int enqueue_burst(burst_queue_t* q, const burst_t* burst) {
-    burst_node_t* node = malloc(sizeof(burst_node_t));
-    if (!node) return 0;
-
-    node->burst = malloc(sizeof(burst_t));
-    if (!node->burst) {
-        free(node);
-        return 0;
+    madvise(map, size, MADV_SEQUENTIAL);
+    int r = parse_bursts(array, map, size);
+    munmap(map, size);
+    if (r < 0) {
+        free_bursts(array);
+        return -1;
     }
+    return (int) array->count;
+}
 
-    *node->burst = *burst; // Deep copy the struct
-    node->next = NULL;
-
-    if (q->tail) {
-        q->tail->next = node;
+void free_bursts(burst_array_t *array) {
+    if (array->map) {
+        munmap(array->map, array->map_size);
     } else {
-        q->head = node;
+        free(array->bursts);
+        free(array->pages);
     }
-    q->tail = node;
-    return 1;
+    *array = (burst_array_t) {0};
 }
 
-burst_t* dequeue_burst(burst_queue_t* q) {
-    if (!q || !q->head) return NULL;
-
-    burst_node_t* node = q->head;
-    burst_t* result = node->burst;
-
-    q->head = node->next;
-    if (!q->head)
-        q->tail = NULL;
-
-    free(node);
-    return result;
+int write_burst_file(const burst_array_t *array, const char *filename) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) return -1;
+    burst_file_header_t header = {
+        .version = BURST_FILE_VERSION,
+        .record_size = sizeof(burst_t),
+        .count = array->count,
+        .n_pages = array->n_pages
+    };
+    memcpy(header.magic, BURST_FILE_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(array->bursts, sizeof(burst_t), array->count, file) != array->count ||
+        fwrite(array->pages, sizeof(uint32_t), array->n_pages, file) != array->n_pages) {
+        fclose(file);
+        return -1;
+    }
+    return fclose(file);
 }
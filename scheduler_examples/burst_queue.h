@@ -3,27 +3,77 @@
 
 #include "msg.h"
 
+// Bursts are stored by value in arrays, their pages live out of line in a separate array of
+// their container (see burst_pages()), so a burst without pages costs 20 bytes instead of
+// carrying a whole page_info_t.
 typedef struct {
     uint32_t burst_time_ms;         // Burst time in milliseconds
-    uint32_t block_time_ms;         // Burst time in milliseconds
-    int nice;                       // Nice value (priority)
-    page_info_t pages;
+    uint32_t block_time_ms;         // Block time in milliseconds
+    int32_t nice;                   // Nice value (priority)
+    uint32_t first_page;            // Index of the first page in the pages of the container
+    uint32_t n_pages;               // Number of pages, up to MAX_PAGES
 } burst_t;
 
+// Bursts of a file in one contiguous array
+typedef struct {
+    burst_t *bursts;
+    uint32_t count;
+    uint32_t *pages;                // Pages of all the bursts
+    uint32_t n_pages;
+    void *map;                      // Mapping of the compiled file the bursts live in, NULL if allocated
+    size_t map_size;
+} burst_array_t;
+
+// Compiled burst file: a burst_file_header_t followed by `count` burst_t and `n_pages`
+// page ids, used in place once mapped
+#define BURST_FILE_MAGIC "OSSIMBST"
+#define BURST_FILE_VERSION 2
+
+typedef struct {
+    char magic[8];                  // BURST_FILE_MAGIC, without the terminator
+    uint32_t version;               // BURST_FILE_VERSION
+    uint32_t record_size;           // sizeof(burst_t)
+    uint64_t count;                 // Number of bursts
+    uint64_t n_pages;               // Number of page ids after the bursts
+} burst_file_header_t;
+
+/**
+ * @brief Parse one line of a burst file: burst_ms[,block_ms[,nice[,[page,page,...]]]]
+ *
+ * @param pages Receives the pages of the burst, room for MAX_PAGES, first_page is set to 0
+ * @return 0 on success, -1 if the line is malformed
+ */
+int parse_burst_line(const char* line, burst_t* burst, uint32_t *pages);
 
-typedef struct burst_node {
-    burst_t *burst;
-    struct burst_node* next;
-} burst_node_t;
+/**
+ * @brief Load a burst file, either a CSV file or a compiled one (see burstc)
+ *
+ * CSV files are mapped and parsed in a single pass into one array, comment (#) and
+ * malformed lines are skipped. Compiled files are mapped and used in place.
+ *
+ * @param array Receives the bursts, to be released with free_bursts()
+ * @param filename The file
+ * @return The number of bursts, or -1 on failure
+ */
+int load_bursts(burst_array_t *array, const char *filename);
 
-typedef struct burst_queue_st  {
-    burst_node_t* head;
-    burst_node_t* tail;
-} burst_queue_t;
+/**
+ * @brief Release the bursts of load_bursts()
+ */
+void free_bursts(burst_array_t *array);
 
-int read_queue_from_file(burst_queue_t* queue, const char* filename);
-int enqueue_burst(burst_queue_t* q, const burst_t* burst);
-burst_t* dequeue_burst(burst_queue_t* q);
+/**
+ * @brief Write bursts to a compiled burst file
+ *
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int write_burst_file(const burst_array_t *array, const char *filename);
 
+/**
+ * @brief The pages of a burst of an array
+ */
+static inline const uint32_t *burst_pages(const burst_array_t *array, const burst_t *burst) {
+    return array->pages + burst->first_page;
+}
 
 #endif //BURST_QUEUE_H
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "burst_queue.h"
+
+/*
+ * Compile a CSV burst file into the binary format of burst_queue.h, which app-io and
+ * simbench map and use in place instead of parsing the text on every run.
+ */
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        printf("Usage: %s <burst-file.csv> <output.bst>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    burst_array_t bursts;
+    if (load_bursts(&bursts, argv[1]) < 0) {
+        fprintf(stderr, "Failed to read burst file %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (write_burst_file(&bursts, argv[2]) < 0) {
+        perror(argv[2]);
+        free_bursts(&bursts);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "%u bursts written to %s\n", bursts.count, argv[2]);
+    free_bursts(&bursts);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,394 @@
+#include "cfs.h"
+
+#include <stdio.h>
+
+#include "msg.h"
+#include "nice.h"
+#include "policy.h"
+
+void cfs_config_default(cfs_config_t *config) {
+    config->target_latency_ms = CFS_DEFAULT_LATENCY_MS;
+    config->min_granularity_ms = CFS_DEFAULT_GRANULARITY_MS;
+}
+
+void cfs_init(cfs_t *cfs, const cfs_config_t *config) {
+    *cfs = (cfs_t) {0};
+    if (config) {
+        cfs->config = *config;
+    } else {
+        cfs_config_default(&cfs->config);
+    }
+}
+
+// Red-black tree, with NULL leaves
+
+static int pcb_before(const pcb_t *a, const pcb_t *b) {
+    return (a->vruntime < b->vruntime) || (a->vruntime == b->vruntime && a->cfs_seq < b->cfs_seq);
+}
+
+static int is_red(const pcb_t *pcb) {
+    return pcb && pcb->rb_red;
+}
+
+/**
+ * @brief Put v in the place of u under the parent of u
+ */
+static void replace_child(cfs_t *cfs, pcb_t *u, pcb_t *v) {
+    if (!u->rb_parent) {
+        cfs->root = v;
+    } else if (u == u->rb_parent->rb_left) {
+        u->rb_parent->rb_left = v;
+    } else {
+        u->rb_parent->rb_right = v;
+    }
+    if (v) v->rb_parent = u->rb_parent;
+}
+
+static void rotate_left(cfs_t *cfs, pcb_t *x) {
+    pcb_t *y = x->rb_right;
+    x->rb_right = y->rb_left;
+    if (y->rb_left) y->rb_left->rb_parent = x;
+    replace_child(cfs, x, y);
+    y->rb_left = x;
+    x->rb_parent = y;
+}
+
+static void rotate_right(cfs_t *cfs, pcb_t *x) {
+    pcb_t *y = x->rb_left;
+    x->rb_left = y->rb_right;
+    if (y->rb_right) y->rb_right->rb_parent = x;
+    replace_child(cfs, x, y);
+    y->rb_right = x;
+    x->rb_parent = y;
+}
+
+static void tree_insert(cfs_t *cfs, pcb_t *pcb) {
+    pcb->cfs_seq = cfs->next_seq++;
+    pcb_t *parent = NULL;
+    pcb_t **link = &cfs->root;
+    int leftmost = 1;
+    while (*link) {
+        parent = *link;
+        if (pcb_before(pcb, parent)) {
+            link = &parent->rb_left;
+        } else {
+            link = &parent->rb_right;
+            leftmost = 0;
+        }
+    }
+    pcb->rb_parent = parent;
+    pcb->rb_left = NULL;
+    pcb->rb_right = NULL;
+    pcb->rb_red = 1;
+    *link = pcb;
+    if (leftmost) cfs->leftmost = pcb;
+
+    // Restore the colors: a red node has black children
+    pcb_t *z = pcb;
+    while (is_red(z->rb_parent)) {
+        pcb_t *p = z->rb_parent;
+        pcb_t *g = p->rb_parent;    // Exists, the root is black
+        if (p == g->rb_left) {
+            pcb_t *uncle = g->rb_right;
+            if (is_red(uncle)) {
+                p->rb_red = 0;
+                uncle->rb_red = 0;
+                g->rb_red = 1;
+                z = g;
+            } else {
+                if (z == p->rb_right) {
+                    z = p;
+                    rotate_left(cfs, z);
+                    p = z->rb_parent;
+                }
+                p->rb_red = 0;
+                g->rb_red = 1;
+                rotate_right(cfs, g);
+            }
+        } else {
+            pcb_t *uncle = g->rb_left;
+            if (is_red(uncle)) {
+                p->rb_red = 0;
+                uncle->rb_red = 0;
+                g->rb_red = 1;
+                z = g;
+            } else {
+                if (z == p->rb_left) {
+                    z = p;
+                    rotate_right(cfs, z);
+                    p = z->rb_parent;
+                }
+                p->rb_red = 0;
+                g->rb_red = 1;
+                rotate_left(cfs, g);
+            }
+        }
+    }
+    cfs->root->rb_red = 0;
+}
+
+static pcb_t *successor(pcb_t *pcb) {
+    if (pcb->rb_right) {
+        pcb = pcb->rb_right;
+        while (pcb->rb_left) pcb = pcb->rb_left;
+        return pcb;
+    }
+    while (pcb->rb_parent && pcb == pcb->rb_parent->rb_right) pcb = pcb->rb_parent;
+    return pcb->rb_parent;
+}
+
+/**
+ * @brief Restore the black height after removing a black node, x (maybe NULL) took its place under parent
+ */
+static void erase_fixup(cfs_t *cfs, pcb_t *x, pcb_t *parent) {
+    while (x != cfs->root && !is_red(x)) {
+        if (x == parent->rb_left) {
+            pcb_t *w = parent->rb_right;
+            if (is_red(w)) {
+                w->rb_red = 0;
+                parent->rb_red = 1;
+                rotate_left(cfs, parent);
+                w = parent->rb_right;
+            }
+            if (!is_red(w->rb_left) && !is_red(w->rb_right)) {
+                w->rb_red = 1;
+                x = parent;
+                parent = x->rb_parent;
+            } else {
+                if (!is_red(w->rb_right)) {
+                    w->rb_left->rb_red = 0;
+                    w->rb_red = 1;
+                    rotate_right(cfs, w);
+                    w = parent->rb_right;
+                }
+                w->rb_red = parent->rb_red;
+                parent->rb_red = 0;
+                w->rb_right->rb_red = 0;
+                rotate_left(cfs, parent);
+                x = cfs->root;
+            }
+        } else {
+            pcb_t *w = parent->rb_left;
+            if (is_red(w)) {
+                w->rb_red = 0;
+                parent->rb_red = 1;
+                rotate_right(cfs, parent);
+                w = parent->rb_left;
+            }
+            if (!is_red(w->rb_left) && !is_red(w->rb_right)) {
+                w->rb_red = 1;
+                x = parent;
+                parent = x->rb_parent;
+            } else {
+                if (!is_red(w->rb_left)) {
+                    w->rb_right->rb_red = 0;
+                    w->rb_red = 1;
+                    rotate_left(cfs, w);
+                    w = parent->rb_left;
+                }
+                w->rb_red = parent->rb_red;
+                parent->rb_red = 0;
+                w->rb_left->rb_red = 0;
+                rotate_right(cfs, parent);
+                x = cfs->root;
+            }
+        }
+    }
+    if (x) x->rb_red = 0;
+}
+
+static void tree_erase(cfs_t *cfs, pcb_t *z) {
+    if (cfs->leftmost == z) cfs->leftmost = successor(z);
+
+    pcb_t *x;
+    pcb_t *x_parent;
+    int removed_red = z->rb_red;
+    if (!z->rb_left) {
+        x = z->rb_right;
+        x_parent = z->rb_parent;
+        replace_child(cfs, z, x);
+    } else if (!z->rb_right) {
+        x = z->rb_left;
+        x_parent = z->rb_parent;
+        replace_child(cfs, z, x);
+    } else {
+        // Two children: the successor takes the place and the color of z
+        pcb_t *y = z->rb_right;
+        while (y->rb_left) y = y->rb_left;
+        removed_red = y->rb_red;
+        x = y->rb_right;
+        if (y->rb_parent == z) {
+            x_parent = y;
+        } else {
+            x_parent = y->rb_parent;
+            replace_child(cfs, y, x);
+            y->rb_right = z->rb_right;
+            y->rb_right->rb_parent = y;
+        }
+        replace_child(cfs, z, y);
+        y->rb_left = z->rb_left;
+        y->rb_left->rb_parent = y;
+        y->rb_red = z->rb_red;
+    }
+    if (!removed_red) erase_fixup(cfs, x, x_parent);
+    z->rb_parent = z->rb_left = z->rb_right = NULL;
+}
+
+// The ready queue
+
+static void queue_in_tree(cfs_t *cfs, pcb_t *pcb) {
+    tree_insert(cfs, pcb);
+    pcb->cfs = cfs;
+    cfs->length++;
+    cfs->load_weight += nice_to_weight(pcb->nice);
+}
+
+int cfs_enqueue(cfs_t *cfs, pcb_t *pcb) {
+    if (pcb_is_queued(pcb)) return 0;
+    // Every core has its own min_vruntime. A pcb that last ran on another core keeps its lag
+    // behind (or lead over) the min_vruntime of that core, measured against this one
+    if (pcb->cfs_home && pcb->cfs_home != cfs) {
+        uint64_t from = pcb->cfs_home->min_vruntime;
+        if (pcb->vruntime >= from) {
+            pcb->vruntime = cfs->min_vruntime + (pcb->vruntime - from);
+        } else {
+            uint64_t lag = from - pcb->vruntime;
+            pcb->vruntime = (cfs->min_vruntime > lag) ? cfs->min_vruntime - lag : 0;
+        }
+    }
+    pcb->cfs_home = cfs;
+    uint64_t credit_us = (uint64_t) cfs->config.target_latency_ms * 1000 / 2;
+    uint64_t floor = (cfs->min_vruntime > credit_us) ? cfs->min_vruntime - credit_us : 0;
+    if (pcb->vruntime < floor) pcb->vruntime = floor;
+    queue_in_tree(cfs, pcb);
+    return 1;
+}
+
+pcb_t *cfs_remove(cfs_t *cfs, pcb_t *pcb) {
+    if (pcb->cfs != cfs) return NULL;
+    tree_erase(cfs, pcb);
+    pcb->cfs = NULL;
+    cfs->length--;
+    cfs->load_weight -= nice_to_weight(pcb->nice);
+    return pcb;
+}
+
+pcb_t *cfs_dequeue(cfs_t *cfs) {
+    if (!cfs->leftmost) return NULL;
+    return cfs_remove(cfs, cfs->leftmost);
+}
+
+/**
+ * @brief Add the time the running pcb used since it was last charged to its vruntime
+ */
+static void update_curr(cfs_t *cfs, pcb_t *curr, uint32_t current_time_ms) {
+    uint64_t delta_us = (uint64_t) (current_time_ms - cfs->charged_ms) * 1000;
+    curr->vruntime += delta_us * NICE_0_WEIGHT / nice_to_weight(curr->nice);
+    cfs->charged_ms = current_time_ms;
+}
+
+static void update_min_vruntime(cfs_t *cfs, const pcb_t *curr) {
+    uint64_t vruntime;
+    if (curr && cfs->leftmost) {
+        vruntime = (curr->vruntime < cfs->leftmost->vruntime) ? curr->vruntime : cfs->leftmost->vruntime;
+    } else if (curr) {
+        vruntime = curr->vruntime;
+    } else if (cfs->leftmost) {
+        vruntime = cfs->leftmost->vruntime;
+    } else {
+        return;
+    }
+    if (vruntime > cfs->min_vruntime) cfs->min_vruntime = vruntime;
+}
+
+/**
+ * @brief Slice of the running pcb: its share of the period, by weight
+ */
+static uint32_t slice_ms(const cfs_t *cfs, const pcb_t *curr) {
+    uint64_t n = cfs->length + 1;
+    uint64_t period_ms = cfs->config.target_latency_ms;
+    if (n * cfs->config.min_granularity_ms > period_ms) period_ms = n * cfs->config.min_granularity_ms;
+    uint64_t weight = nice_to_weight(curr->nice);
+    uint64_t slice = period_ms * weight / (cfs->load_weight + weight);
+    return (slice > cfs->config.min_granularity_ms) ? (uint32_t) slice : cfs->config.min_granularity_ms;
+}
+
+uint32_t cfs_ticks_to_next_event(const cfs_t *cfs, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    if (!cfs->leftmost) return UINT32_MAX;
+    // The slice ends in the first tick at or after slice_start_ms + slice
+    uint32_t end_ms = cpu_task->slice_start_ms + slice_ms(cfs, cpu_task);
+    return (end_ms >= current_time_ms) ? (end_ms - current_time_ms + TICKS_MS - 1) / TICKS_MS + 1 : 1;
+}
+
+void cfs_scheduler(uint32_t current_time_ms, cfs_t *cfs, pcb_t **cpu_task) {
+    if (*cpu_task) {
+        pcb_t *task = *cpu_task;
+        task->ellapsed_time_ms += TICKS_MS;
+        update_curr(cfs, task, current_time_ms);
+
+        if (task->ellapsed_time_ms >= task->time_ms) {
+            // Burst finished: the pcb keeps its vruntime and waits for the next command
+            task->status = TASK_COMMAND;
+            *cpu_task = NULL;
+        } else if (cfs->leftmost && current_time_ms - task->slice_start_ms >= slice_ms(cfs, task)) {
+            // Slice over: back to the tree, it runs again right away if it is still the leftmost
+            queue_in_tree(cfs, task);
+            *cpu_task = NULL;
+        }
+    }
+    update_min_vruntime(cfs, *cpu_task);
+
+    if (*cpu_task == NULL) {
+        *cpu_task = cfs_dequeue(cfs);
+        if (*cpu_task) {
+            (*cpu_task)->slice_start_ms = current_time_ms;
+            cfs->charged_ms = current_time_ms;
+        }
+    }
+}
+
+static int cfs_rq_init(void *rq, uint32_t capacity, const scheduler_config_t *config) {
+    cfs_init(rq, config ? &config->cfs : NULL);
+    return 0;
+}
+
+static int cfs_rq_enqueue(void *rq, pcb_t *pcb) {
+    return cfs_enqueue(rq, pcb);
+}
+
+static pcb_t *cfs_rq_pick_next(void *rq) {
+    return cfs_dequeue(rq);
+}
+
+static pcb_t *cfs_rq_remove(void *rq, pcb_t *pcb) {
+    return cfs_remove(rq, pcb);
+}
+
+static uint32_t cfs_rq_length(const void *rq) {
+    return ((const cfs_t *) rq)->length;
+}
+
+static void cfs_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    cfs_scheduler(current_time_ms, rq, cpu_task);
+}
+
+static uint32_t cfs_ticks_to_event(const void *rq, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    return cfs_ticks_to_next_event(rq, cpu_task, current_time_ms);
+}
+
+static void cfs_print_stats(const void *rq) {
+    printf("  CFS: min vruntime %.3f s\n", ((const cfs_t *) rq)->min_vruntime / 1e6);
+}
+
+const scheduler_t CFS_SCHEDULER = {
+    .name = "CFS",
+    .rq_size = sizeof(cfs_t),
+    .init = cfs_rq_init,
+    .enqueue = cfs_rq_enqueue,
+    .pick_next = cfs_rq_pick_next,
+    .remove = cfs_rq_remove,
+    .length = cfs_rq_length,
+    .tick = cfs_tick,
+    .ticks_to_event = cfs_ticks_to_event,
+    .print_stats = cfs_print_stats,
+};
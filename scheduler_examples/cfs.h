@@ -0,0 +1,86 @@
+#ifndef CFS_H
+#define CFS_H
+
+#include <stdint.h>
+
+#include "queue.h"
+
+#define CFS_DEFAULT_LATENCY_MS 100      // Period in which every runnable pcb should run once
+#define CFS_DEFAULT_GRANULARITY_MS 20   // Shortest slice, the period grows when there are more pcbs
+
+typedef struct {
+    uint32_t target_latency_ms;
+    uint32_t min_granularity_ms;
+} cfs_config_t;
+
+// The CFS ready queue: a red-black tree of the pcbs through the pcbs themselves, ordered by
+// vruntime, with the leftmost (smallest) pcb cached
+typedef struct cfs_st {
+    cfs_config_t config;
+    pcb_t *root;
+    pcb_t *leftmost;
+    uint32_t length;                // Number of pcbs in the tree
+    uint64_t load_weight;           // Sum of the weights of the pcbs in the tree
+    uint64_t min_vruntime;          // Never decreases, new and waking pcbs are placed relative to it
+    uint64_t next_seq;              // Insertion counter, to break ties in FIFO order
+    uint32_t charged_ms;            // Time up to which the running pcb has been charged
+} cfs_t;
+
+/**
+ * @brief Fill a configuration with the default values
+ */
+void cfs_config_default(cfs_config_t *config);
+
+/**
+ * @brief Initialize an empty CFS ready queue
+ *
+ * @param config The configuration, or NULL for the defaults
+ */
+void cfs_init(cfs_t *cfs, const cfs_config_t *config);
+
+/**
+ * @brief Add a pcb that starts or resumes running to the tree, in O(log n)
+ *
+ * A pcb coming back from a block (or a new one) is given at most half a target latency of
+ * credit over min_vruntime, so sleeping does not buy an unbounded share of the CPU. A pcb that
+ * last ran on another core is first moved to the min_vruntime of this one, keeping its lag.
+ *
+ * @return 1 on success, 0 if the pcb is already in a queue, heap or tree
+ */
+int cfs_enqueue(cfs_t *cfs, pcb_t *pcb);
+
+/**
+ * @brief Take a pcb out of the tree, in O(log n)
+ *
+ * @return The pcb, or NULL if it was not in this tree
+ */
+pcb_t *cfs_remove(cfs_t *cfs, pcb_t *pcb);
+
+/**
+ * @brief Take the pcb with the smallest vruntime out of the tree, in O(log n)
+ *
+ * @return The pcb, or NULL if the tree is empty
+ */
+pcb_t *cfs_dequeue(cfs_t *cfs);
+
+/**
+ * @brief Number of ticks until the running pcb uses up its slice, at least 1
+ *
+ * @param current_time_ms The time of the next tick
+ * @return The number of ticks, UINT32_MAX if no pcb is waiting to take its place
+ */
+uint32_t cfs_ticks_to_next_event(const cfs_t *cfs, const pcb_t *cpu_task, uint32_t current_time_ms);
+
+/**
+ * @brief Completely Fair Scheduler (CFS) algorithm
+ *
+ * - Every pcb accumulates a vruntime: the CPU time it used, scaled by NICE_0_WEIGHT over the
+ *   weight of its nice value, so low nice pcbs age slower.
+ * - The CPU runs the pcb with the smallest vruntime, the leftmost node of the tree.
+ * - Its slice is its share, by weight, of a period of target_latency_ms (or min_granularity_ms
+ *   per pcb when there are too many of them), and never less than min_granularity_ms.
+ * - When the slice is over and another pcb is waiting, the running pcb goes back to the tree.
+ */
+void cfs_scheduler(uint32_t current_time_ms, cfs_t *cfs, pcb_t **cpu_task);
+
+#endif //CFS_H
@@ -0,0 +1,221 @@
+#include "exporter.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define EXPORTER_BODY_SIZE 8192
+#define EXPORTER_REQUEST_TIMEOUT_MS 100     // How long to wait for an HTTP request before answering anyway
+
+struct exporter_st {
+    int listen_fd;
+    pthread_t thread;
+    const exporter_metrics_t *metrics;
+    const char *policy;
+    char socket_path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+};
+
+static uint64_t load(const _Atomic uint64_t *metric) {
+    return atomic_load_explicit((_Atomic uint64_t *) metric, memory_order_relaxed);
+}
+
+/**
+ * @brief Append one metric with its HELP and TYPE lines
+ *
+ * @return The new length of the body
+ */
+static size_t append_metric(char *body, size_t length, const char *name, const char *type, const char *help,
+                            const char *labels, double value) {
+    if (length >= EXPORTER_BODY_SIZE) return length;
+    int n = snprintf(body + length, EXPORTER_BODY_SIZE - length, "# HELP %s %s\n# TYPE %s %s\n%s{%s} %.17g\n",
+                     name, help, name, type, name, labels, value);
+    return (n > 0) ? length + (size_t) n : length;
+}
+
+/**
+ * @brief Format all the metrics in the Prometheus text format
+ *
+ * @return The length of the body
+ */
+static size_t format_metrics(const exporter_t *exporter, char *body) {
+    const exporter_metrics_t *m = exporter->metrics;
+    char labels[96];
+    snprintf(labels, sizeof(labels), "policy=\"%s\"", exporter->policy);
+    size_t n = 0;
+    n = append_metric(body, n, "ossim_time_seconds", "gauge", "Simulated time.", labels,
+                      (double) load(&m->time_ms) / 1000.0);
+    n = append_metric(body, n, "ossim_tick_overruns_total", "counter",
+                      "Ticks that started a whole tick or more after their deadline.", labels,
+                      (double) load(&m->tick_overruns));
+    n = append_metric(body, n, "ossim_idle_ticks_total", "counter", "Ticks skipped while the cores were idle.",
+                      labels, (double) load(&m->idle_ticks));
+    n = append_metric(body, n, "ossim_clients", "gauge", "Connected applications.", labels,
+                      (double) load(&m->clients));
+    n = append_metric(body, n, "ossim_running", "gauge", "Cores running an application.", labels,
+                      (double) load(&m->running));
+    n = append_metric(body, n, "ossim_ready_queue_length", "gauge", "Applications in the ready queues.", labels,
+                      (double) load(&m->ready));
+    n = append_metric(body, n, "ossim_blocked_queue_length", "gauge", "Applications in the blocked queue.", labels,
+                      (double) load(&m->blocked));
+    n = append_metric(body, n, "ossim_command_queue_length", "gauge",
+                      "Applications that still have to send their next command.", labels,
+                      (double) load(&m->awaiting_commands));
+    n = append_metric(body, n, "ossim_dispatches_total", "counter", "Context switches to an application.", labels,
+                      (double) load(&m->dispatches));
+    n = append_metric(body, n, "ossim_preemptions_total", "counter",
+                      "Applications taken off a core before the end of their burst.", labels,
+                      (double) load(&m->preemptions));
+    n = append_metric(body, n, "ossim_steals_total", "counter", "Applications stolen by an idle core.", labels,
+                      (double) load(&m->steals));
+
+    // run_machine() as a summary without quantiles, plus its maximum
+    if (n < EXPORTER_BODY_SIZE) {
+        int len = snprintf(body + n, EXPORTER_BODY_SIZE - n,
+                           "# HELP ossim_schedule_seconds Time spent by the policy in a tick: accounting, "
+                           "preemption, pick next and steals.\n"
+                           "# TYPE ossim_schedule_seconds summary\n"
+                           "ossim_schedule_seconds_sum{%s} %.9f\n"
+                           "ossim_schedule_seconds_count{%s} %llu\n",
+                           labels, (double) load(&m->schedule_ns) / 1e9, labels,
+                           (unsigned long long) load(&m->schedule_calls));
+        if (len > 0) n += (size_t) len;
+    }
+    n = append_metric(body, n, "ossim_schedule_max_seconds", "gauge", "Longest time spent by the policy in a tick.",
+                      labels, (double) load(&m->schedule_max_ns) / 1e9);
+
+    n = append_metric(body, n, "ossim_messages_received_total", "counter", "Messages received from the applications.",
+                      labels, (double) load(&m->msgs_received));
+    n = append_metric(body, n, "ossim_messages_sent_total", "counter", "Messages sent to the applications.", labels,
+                      (double) load(&m->msgs_sent));
+
+    // One series per system call of the socket server
+    static const char *calls[] = {"read", "write", "epoll_wait", "accept"};
+    const _Atomic uint64_t *counts[] = {&m->reads, &m->writes, &m->epoll_waits, &m->accepts};
+    if (n < EXPORTER_BODY_SIZE) {
+        int len = snprintf(body + n, EXPORTER_BODY_SIZE - n,
+                           "# HELP ossim_syscalls_total System calls of the socket server.\n"
+                           "# TYPE ossim_syscalls_total counter\n");
+        if (len > 0) n += (size_t) len;
+    }
+    for (size_t i = 0; i < sizeof(calls) / sizeof(calls[0]) && n < EXPORTER_BODY_SIZE; i++) {
+        int len = snprintf(body + n, EXPORTER_BODY_SIZE - n, "ossim_syscalls_total{%s,call=\"%s\"} %llu\n",
+                           labels, calls[i], (unsigned long long) load(counts[i]));
+        if (len > 0) n += (size_t) len;
+    }
+    return (n < EXPORTER_BODY_SIZE) ? n : EXPORTER_BODY_SIZE - 1;
+}
+
+static int write_all(int fd, const char *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, buffer, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buffer += n;
+        size -= (size_t) n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Answer one scraper: with an HTTP response if it sent a request, the bare metrics otherwise
+ */
+static void serve_client(const exporter_t *exporter, int client_fd) {
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = EXPORTER_REQUEST_TIMEOUT_MS * 1000};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char request[512];
+    ssize_t n = read(client_fd, request, sizeof(request) - 1);
+    int http = (n >= 4 && memcmp(request, "GET ", 4) == 0);
+
+    char body[EXPORTER_BODY_SIZE];
+    size_t length = format_metrics(exporter, body);
+    if (http) {
+        char header[160];
+        int header_length = snprintf(header, sizeof(header),
+                                     "HTTP/1.0 200 OK\r\n"
+                                     "Content-Type: text/plain; version=0.0.4\r\n"
+                                     "Content-Length: %zu\r\n"
+                                     "Connection: close\r\n\r\n", length);
+        if (write_all(client_fd, header, (size_t) header_length) < 0) return;
+    }
+    write_all(client_fd, body, length);
+}
+
+static void *exporter_thread(void *arg) {
+    exporter_t *exporter = arg;
+    while (1) {
+        int client_fd = accept(exporter->listen_fd, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;      // The socket was shut down by exporter_stop()
+        }
+        serve_client(exporter, client_fd);
+        close(client_fd);
+    }
+    return NULL;
+}
+
+exporter_t *exporter_start(const char *socket_path, const exporter_metrics_t *metrics, const char *policy) {
+    exporter_t *exporter = calloc(1, sizeof(exporter_t));
+    if (!exporter) {
+        perror("calloc");
+        return NULL;
+    }
+    exporter->metrics = metrics;
+    exporter->policy = policy;
+    if (strlen(socket_path) >= sizeof(exporter->socket_path)) {
+        fprintf(stderr, "Metrics socket path too long: %s\n", socket_path);
+        free(exporter);
+        return NULL;
+    }
+    strcpy(exporter->socket_path, socket_path);
+
+    exporter->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (exporter->listen_fd < 0) {
+        perror("socket: metrics");
+        free(exporter);
+        return NULL;
+    }
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+    if (bind(exporter->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        listen(exporter->listen_fd, 8) < 0) {
+        perror(socket_path);
+        close(exporter->listen_fd);
+        free(exporter);
+        return NULL;
+    }
+    // The signals of the simulator must interrupt the tick loop, not this thread
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int err = pthread_create(&exporter->thread, NULL, exporter_thread, exporter);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (err != 0) {
+        fprintf(stderr, "pthread_create: %s\n", strerror(err));
+        close(exporter->listen_fd);
+        unlink(socket_path);
+        free(exporter);
+        return NULL;
+    }
+    return exporter;
+}
+
+void exporter_stop(exporter_t *exporter) {
+    if (!exporter) return;
+    // Wakes up the accept() of the thread
+    shutdown(exporter->listen_fd, SHUT_RDWR);
+    pthread_join(exporter->thread, NULL);
+    close(exporter->listen_fd);
+    unlink(exporter->socket_path);
+    free(exporter);
+}
@@ -0,0 +1,73 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Live metrics of the simulator in the Prometheus text format, served on a UNIX socket of
+ * their own by a thread, so scraping never touches the tick loop.
+ *
+ * The tick loop keeps its counters in plain variables and publishes them once per tick with
+ * relaxed atomic stores. The exporter thread only loads them, so neither side ever waits for
+ * the other; a scrape may mix values of two consecutive ticks.
+ *
+ * The scraper may speak HTTP (GET /metrics) or just connect and read, e.g.
+ *   curl --unix-socket /tmp/scheduler-metrics.sock http://localhost/metrics
+ *   nc -U /tmp/scheduler-metrics.sock
+ */
+
+#define METRICS_SOCKET_PATH "/tmp/scheduler-metrics.sock"
+
+typedef struct {
+    // Clock
+    _Atomic uint64_t time_ms;           // Simulated time
+    _Atomic uint64_t tick_overruns;     // Ticks that started a whole tick late
+    _Atomic uint64_t idle_ticks;        // Ticks skipped while idle
+    // Queues
+    _Atomic uint64_t clients;           // Connected applications
+    _Atomic uint64_t running;           // Cores running a pcb
+    _Atomic uint64_t ready;             // Pcbs in the ready queues of all the cores
+    _Atomic uint64_t blocked;           // Pcbs in the blocked queue
+    _Atomic uint64_t awaiting_commands; // Applications that still have to send their next command
+    // Scheduling, summed over the cores
+    _Atomic uint64_t dispatches;
+    _Atomic uint64_t preemptions;
+    _Atomic uint64_t steals;
+    _Atomic uint64_t schedule_ns;       // Time spent in run_machine()
+    _Atomic uint64_t schedule_calls;
+    _Atomic uint64_t schedule_max_ns;   // Longest run_machine()
+    // Socket traffic
+    _Atomic uint64_t msgs_received;
+    _Atomic uint64_t msgs_sent;
+    _Atomic uint64_t reads;
+    _Atomic uint64_t writes;
+    _Atomic uint64_t epoll_waits;
+    _Atomic uint64_t accepts;
+} exporter_metrics_t;
+
+typedef struct exporter_st exporter_t;
+
+/**
+ * @brief Listen on a UNIX socket and start the thread that serves the metrics
+ *
+ * @param socket_path The path of the socket, replaced if it exists
+ * @param metrics The metrics published by the tick loop, which must outlive the exporter
+ * @param policy The name of the scheduling policy, used as a label
+ * @return The exporter, or NULL on failure (reported on stderr)
+ */
+exporter_t *exporter_start(const char *socket_path, const exporter_metrics_t *metrics, const char *policy);
+
+/**
+ * @brief Stop the thread, close and remove the socket
+ */
+void exporter_stop(exporter_t *exporter);
+
+/**
+ * @brief Publish a value for the exporter, without any ordering with the other values
+ */
+static inline void exporter_set(_Atomic uint64_t *metric, uint64_t value) {
+    atomic_store_explicit(metric, value, memory_order_relaxed);
+}
+
+#endif //EXPORTER_H
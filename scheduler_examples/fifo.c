@@ -4,13 +4,13 @@
 #include <stdlib.h>
 
 #include "msg.h"
-#include <unistd.h>
+#include "policy.h"
 
 /**
  * @brief First-In-First-Out (FIFO) scheduling algorithm.
  *
  * This function implements the FIFO scheduling algorithm. If the CPU is not idle it
- * checks if the application is ready and frees the CPU.
+ * checks if the application burst is over and frees the CPU.
  * If the CPU is idle, it selects the next task to run based on the order they were added
  * to the ready queue. The task that has been in the queue the longest is selected to run next.
  *
@@ -44,28 +44,12 @@ void fifo_scheduler(uint32_t current_time_ms, queue_t *rq, pcb_t **cpu_task) {
                 *Se ellapsed_time_ms >= time_ms, o processo terminou.
                 *
             */
-            // Task finished
-            // Send msg to application
-            msg_t msg = {
-                .pid = (*cpu_task)->pid,
-                .request = PROCESS_REQUEST_DONE,
-                .time_ms = current_time_ms
-            };
             /*
-                 *Envia uma mensagem para informar que o processo terminou.
-                 *msg contém: PID, tipo de requisição (PROCESS_REQUEST_DONE) e tempo atual.
-                 *write envia a mensagem via socket para o processo/aplicação.
-                 *
+                 *O PCB continua associado ao socket da aplicação, à espera do próximo pedido
+                 *(TASK_COMMAND): a simulação (run_machine) vê-o sair da CPU e envia-lhe
+                 *PROCESS_REQUEST_DONE. CPU fica livre (cpu_task = NULL).
              */
-            if (write((*cpu_task)->sockfd, &msg, sizeof(msg_t)) != sizeof(msg_t)) {
-                perror("write");
-            }
-            // Application finished and can be removed (this is FIFO after all)
-            /*
-                 *Libera a memória do processo terminado.
-                 *CPU fica livre (cpu_task = NULL).
-             */
-            free((*cpu_task));
+            (*cpu_task)->status = TASK_COMMAND;
             (*cpu_task) = NULL;
         }
     }
@@ -81,4 +65,40 @@ void fifo_scheduler(uint32_t current_time_ms, queue_t *rq, pcb_t **cpu_task) {
          */
         *cpu_task = dequeue_pcb(rq);   // Get next task from ready queue (dequeue from head)
     }
-}
\ No newline at end of file
+}
+
+static int fifo_rq_init(void *rq, uint32_t capacity, const scheduler_config_t *config) {
+    *(queue_t *) rq = (queue_t) {0};
+    return 0;
+}
+
+static int fifo_rq_enqueue(void *rq, pcb_t *pcb) {
+    return enqueue_pcb(rq, pcb);
+}
+
+static pcb_t *fifo_rq_pick_next(void *rq) {
+    return dequeue_pcb(rq);
+}
+
+static pcb_t *fifo_rq_remove(void *rq, pcb_t *pcb) {
+    return (pcb->queue == rq) ? remove_pcb(rq, pcb) : NULL;
+}
+
+static uint32_t fifo_rq_length(const void *rq) {
+    return ((const queue_t *) rq)->length;
+}
+
+static void fifo_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    fifo_scheduler(current_time_ms, rq, cpu_task);
+}
+
+const scheduler_t FIFO_SCHEDULER = {
+    .name = "FIFO",
+    .rq_size = sizeof(queue_t),
+    .init = fifo_rq_init,
+    .enqueue = fifo_rq_enqueue,
+    .pick_next = fifo_rq_pick_next,
+    .remove = fifo_rq_remove,
+    .length = fifo_rq_length,
+    .tick = fifo_tick,
+};
@@ -0,0 +1,98 @@
+#include "heap.h"
+
+#include <stdlib.h>
+
+int heap_init(pcb_heap_t *heap, uint32_t capacity) {
+    *heap = (pcb_heap_t) {0};
+    if (capacity == 0) capacity = 16;
+    heap->nodes = malloc(sizeof(heap_node_t) * capacity);
+    if (!heap->nodes) return -1;
+    heap->capacity = capacity;
+    return 0;
+}
+
+void heap_destroy(pcb_heap_t *heap) {
+    for (uint32_t i = 0; i < heap->size; i++) {
+        heap->nodes[i].pcb->heap_index = HEAP_NONE;
+    }
+    free(heap->nodes);
+    *heap = (pcb_heap_t) {0};
+}
+
+static int node_less(const heap_node_t *a, const heap_node_t *b) {
+    return (a->key < b->key) || (a->key == b->key && a->seq < b->seq);
+}
+
+static void place(pcb_heap_t *heap, uint32_t i, heap_node_t node) {
+    heap->nodes[i] = node;
+    node.pcb->heap_index = i;
+}
+
+static void sift_up(pcb_heap_t *heap, uint32_t i) {
+    heap_node_t node = heap->nodes[i];
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!node_less(&node, &heap->nodes[parent])) break;
+        place(heap, i, heap->nodes[parent]);
+        i = parent;
+    }
+    place(heap, i, node);
+}
+
+static void sift_down(pcb_heap_t *heap, uint32_t i) {
+    heap_node_t node = heap->nodes[i];
+    while (1) {
+        uint32_t child = 2 * i + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && node_less(&heap->nodes[child + 1], &heap->nodes[child])) child++;
+        if (!node_less(&heap->nodes[child], &node)) break;
+        place(heap, i, heap->nodes[child]);
+        i = child;
+    }
+    place(heap, i, node);
+}
+
+int heap_push(pcb_heap_t *heap, pcb_t *pcb, uint64_t key) {
+    if (pcb_is_queued(pcb)) return 0;
+    if (heap->size == heap->capacity) {
+        uint32_t capacity = heap->capacity ? heap->capacity * 2 : 16;
+        heap_node_t *nodes = realloc(heap->nodes, sizeof(heap_node_t) * capacity);
+        if (!nodes) return 0;
+        heap->nodes = nodes;
+        heap->capacity = capacity;
+    }
+    heap->nodes[heap->size] = (heap_node_t) {.key = key, .seq = heap->next_seq++, .pcb = pcb};
+    sift_up(heap, heap->size++);
+    return 1;
+}
+
+pcb_t *heap_peek(const pcb_heap_t *heap, uint64_t *key) {
+    if (heap->size == 0) return NULL;
+    if (key) *key = heap->nodes[0].key;
+    return heap->nodes[0].pcb;
+}
+
+pcb_t *heap_remove(pcb_heap_t *heap, pcb_t *pcb) {
+    uint32_t i = pcb->heap_index;
+    if (i >= heap->size || heap->nodes[i].pcb != pcb) return NULL;
+
+    pcb->heap_index = HEAP_NONE;
+    heap->size--;
+    if (i < heap->size) {
+        // Move the last node into the hole and restore the order in whichever direction it breaks
+        heap_node_t last = heap->nodes[heap->size];
+        heap_node_t removed = heap->nodes[i];
+        place(heap, i, last);
+        if (node_less(&last, &removed)) {
+            sift_up(heap, i);
+        } else {
+            sift_down(heap, i);
+        }
+    }
+    return pcb;
+}
+
+pcb_t *heap_pop(pcb_heap_t *heap) {
+    if (heap->size == 0) return NULL;
+    return heap_remove(heap, heap->nodes[0].pcb);
+}
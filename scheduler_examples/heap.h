@@ -0,0 +1,70 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdint.h>
+
+#include "queue.h"
+
+typedef struct {
+    uint64_t key;           // Ordering key, smallest first
+    uint64_t seq;           // Insertion order, to break ties in FIFO order
+    pcb_t *pcb;
+} heap_node_t;
+
+// Binary min-heap of pcbs, ordered by (key, insertion order)
+typedef struct {
+    heap_node_t *nodes;
+    uint32_t size;          // Number of pcbs in the heap
+    uint32_t capacity;      // Number of allocated nodes
+    uint64_t next_seq;      // Insertion counter
+} pcb_heap_t;
+
+/**
+ * @brief Allocate the nodes of a heap
+ *
+ * The heap grows on demand, the capacity only avoids reallocations.
+ *
+ * @param heap The heap to initialize
+ * @param capacity The initial number of nodes
+ * @return 0 on success, -1 on failure
+ */
+int heap_init(pcb_heap_t *heap, uint32_t capacity);
+
+/**
+ * @brief Release the nodes of a heap (the pcbs are not freed)
+ */
+void heap_destroy(pcb_heap_t *heap);
+
+/**
+ * @brief Insert a pcb in the heap in O(log n)
+ *
+ * @param heap The heap
+ * @param pcb The pcb, which must not be in a queue or heap
+ * @param key The ordering key of the pcb
+ * @return 1 on success, 0 on failure
+ */
+int heap_push(pcb_heap_t *heap, pcb_t *pcb, uint64_t key);
+
+/**
+ * @brief Remove and return the pcb with the smallest key in O(log n)
+ *
+ * @return The pcb, or NULL if the heap is empty
+ */
+pcb_t *heap_pop(pcb_heap_t *heap);
+
+/**
+ * @brief Return the pcb with the smallest key without removing it
+ *
+ * @param key If not NULL, receives the key of the pcb
+ * @return The pcb, or NULL if the heap is empty
+ */
+pcb_t *heap_peek(const pcb_heap_t *heap, uint64_t *key);
+
+/**
+ * @brief Remove a specific pcb from the heap in O(log n)
+ *
+ * @return The removed pcb, or NULL if the pcb was not in this heap
+ */
+pcb_t *heap_remove(pcb_heap_t *heap, pcb_t *pcb);
+
+#endif //HEAP_H
@@ -0,0 +1,555 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "debug.h"
+#include "msg.h"
+
+/*
+ * Load generator: drives many synthetic applications against the scheduler from a single
+ * process, with one non-blocking socket per application and the msg_t protocol (version 2,
+ * the RUN and the BLOCK of a burst are sent together). The workload is described by a spec
+ * file of `key = value` lines:
+ *
+ *   processes = 1000               Number of applications
+ *   arrival = poisson 20           Arrivals per simulated second, or `all` to start them together
+ *   bursts = uniform 2 10          Bursts per application
+ *   cpu = exponential 200          Length of the CPU bursts (ms)
+ *   io = exponential 500           Length of the blocks after each burst (ms), 0 for none
+ *   nice = 0:80 -5:10 10:10        Nice values and their weights
+ *   seed = 42                      Seed of the random generator
+ *
+ * Distributions: `fixed X`, `uniform MIN MAX`, `exponential MEAN`, `normal MEAN STDDEV`.
+ *
+ * Arrivals follow the simulated clock. A pacer connection blocks until the next arrival is due,
+ * and holds the clock (by not sending its next request) until the applications arriving then
+ * are connected, so the arrival times are exact up to a tick in real and virtual time alike.
+ * Its HELLO carries MSG_HELLO_NO_METRICS, so it is left out of the metrics of the scheduler.
+ */
+
+#define PID_BASE 1000000            // Pids of the synthetic applications start here
+#define MAX_NICE_CLASSES 40
+#define MAX_EVENTS 256
+#define CONNECT_RETRY_MS 10         // Wait before retrying connections refused by a full backlog
+
+typedef enum {
+    DIST_FIXED = 0,
+    DIST_UNIFORM,
+    DIST_EXPONENTIAL,
+    DIST_NORMAL
+} dist_kind_en;
+
+typedef struct {
+    dist_kind_en kind;
+    double a;                       // Value, minimum or mean
+    double b;                       // Maximum or standard deviation
+} dist_t;
+
+typedef struct {
+    uint32_t processes;
+    double arrival_rate;            // Arrivals per simulated second, 0 if they all start at once
+    dist_t bursts;
+    dist_t cpu_ms;
+    dist_t io_ms;
+    int nice[MAX_NICE_CLASSES];
+    double nice_weight[MAX_NICE_CLASSES];
+    uint32_t nice_classes;
+    uint64_t seed;
+} workload_t;
+
+typedef struct {
+    int fd;                         // -1 before the connection and after the end
+    int32_t pid;
+    int nice;
+    int pacer;                      // Paces the arrivals, see above
+    uint32_t arrival_ms;            // Scheduled arrival, simulated
+    uint32_t bursts_left;
+    uint32_t outstanding;           // Requests sent and not DONE yet
+    int started;                    // Received its first ACK
+    uint32_t start_ms;              // First ACK
+    uint32_t finish_ms;             // Last DONE
+    msg_t inbox[MSG_BATCH_MAX];
+    size_t inbox_bytes;
+} client_t;
+
+static uint64_t rng_state;
+
+// Traffic, printed at the end
+static uint64_t msgs_sent = 0;
+static uint64_t msgs_received = 0;
+static uint64_t writes = 0;
+static uint64_t reads = 0;
+
+/**
+ * @brief xorshift64*, more than enough for workloads
+ */
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ull;
+}
+
+// Uniform in (0, 1)
+static double random_unit(void) {
+    return ((next_random() >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double sample(const dist_t *dist) {
+    switch (dist->kind) {
+        case DIST_UNIFORM:
+            return dist->a + (dist->b - dist->a) * random_unit();
+        case DIST_EXPONENTIAL:
+            return -dist->a * log(random_unit());
+        case DIST_NORMAL:
+            // Box-Muller
+            return dist->a + dist->b * sqrt(-2.0 * log(random_unit())) * cos(2.0 * M_PI * random_unit());
+        case DIST_FIXED:
+        default:
+            return dist->a;
+    }
+}
+
+static uint32_t sample_ms(const dist_t *dist, uint32_t min) {
+    double value = round(sample(dist));
+    if (value < min) return min;
+    if (value > UINT32_MAX / 2) return UINT32_MAX / 2;
+    return (uint32_t) value;
+}
+
+static int pick_nice(const workload_t *workload) {
+    if (workload->nice_classes == 0) return 0;
+    double total = 0;
+    for (uint32_t i = 0; i < workload->nice_classes; i++) total += workload->nice_weight[i];
+    double r = random_unit() * total;
+    for (uint32_t i = 0; i < workload->nice_classes; i++) {
+        r -= workload->nice_weight[i];
+        if (r < 0) return workload->nice[i];
+    }
+    return workload->nice[workload->nice_classes - 1];
+}
+
+/**
+ * @brief Parse a distribution such as "exponential 200"
+ *
+ * @return 0 on success, -1 if it is not valid
+ */
+static int parse_dist(const char *text, dist_t *dist) {
+    char name[32];
+    double a = 0, b = 0;
+    int n = sscanf(text, "%31s %lf %lf", name, &a, &b);
+    if (n < 2) return -1;
+    if (strcmp(name, "fixed") == 0 && n == 2) {
+        *dist = (dist_t) {DIST_FIXED, a, 0};
+    } else if (strcmp(name, "uniform") == 0 && n == 3 && a <= b) {
+        *dist = (dist_t) {DIST_UNIFORM, a, b};
+    } else if (strcmp(name, "exponential") == 0 && n == 2 && a > 0) {
+        *dist = (dist_t) {DIST_EXPONENTIAL, a, 0};
+    } else if (strcmp(name, "normal") == 0 && n == 3 && b >= 0) {
+        *dist = (dist_t) {DIST_NORMAL, a, b};
+    } else {
+        return -1;
+    }
+    return a >= 0 ? 0 : -1;
+}
+
+/**
+ * @brief Parse a list of nice:weight pairs
+ */
+static int parse_nice(const char *text, workload_t *workload) {
+    workload->nice_classes = 0;
+    const char *p = text;
+    int nice, consumed;
+    double weight;
+    while (sscanf(p, " %d:%lf%n", &nice, &weight, &consumed) == 2) {
+        if (workload->nice_classes == MAX_NICE_CLASSES || nice < -20 || nice > 19 || weight < 0) return -1;
+        workload->nice[workload->nice_classes] = nice;
+        workload->nice_weight[workload->nice_classes] = weight;
+        workload->nice_classes++;
+        p += consumed;
+    }
+    while (*p == ' ' || *p == '\t') p++;
+    return (*p == '\0' && workload->nice_classes > 0) ? 0 : -1;
+}
+
+/**
+ * @brief Read a workload spec, see the top of the file
+ *
+ * @return 0 on success, -1 on failure (after printing why)
+ */
+static int read_workload(const char *path, workload_t *workload) {
+    *workload = (workload_t) {
+        .processes = 100,
+        .arrival_rate = 0,
+        .bursts = {DIST_FIXED, 5, 0},
+        .cpu_ms = {DIST_EXPONENTIAL, 200, 0},
+        .io_ms = {DIST_EXPONENTIAL, 500, 0},
+        .nice_classes = 0,
+        .seed = 1
+    };
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    char line[512];
+    uint32_t line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+        char key[32];
+        int value_start = -1;
+        if (sscanf(line, " %31[a-z_] = %n", key, &value_start) != 1 || value_start < 0) {
+            if (strspn(line, " \t") == strlen(line)) continue;  // Empty line
+            fprintf(stderr, "%s:%u: expected key = value\n", path, line_number);
+            fclose(file);
+            return -1;
+        }
+        const char *value = line + value_start;
+        int ok = 0;
+        if (strcmp(key, "processes") == 0) {
+            char *end;
+            unsigned long n = strtoul(value, &end, 10);
+            ok = (end != value && n > 0 && n <= 1000000);
+            workload->processes = (uint32_t) n;
+        } else if (strcmp(key, "arrival") == 0) {
+            double rate;
+            if (strncmp(value, "all", 3) == 0) {
+                workload->arrival_rate = 0;
+                ok = 1;
+            } else if (sscanf(value, "poisson %lf", &rate) == 1 && rate > 0) {
+                workload->arrival_rate = rate;
+                ok = 1;
+            }
+        } else if (strcmp(key, "bursts") == 0) {
+            ok = parse_dist(value, &workload->bursts) == 0;
+        } else if (strcmp(key, "cpu") == 0) {
+            ok = parse_dist(value, &workload->cpu_ms) == 0;
+        } else if (strcmp(key, "io") == 0) {
+            ok = parse_dist(value, &workload->io_ms) == 0;
+        } else if (strcmp(key, "nice") == 0) {
+            ok = parse_nice(value, workload) == 0;
+        } else if (strcmp(key, "seed") == 0) {
+            workload->seed = strtoull(value, NULL, 10);
+            ok = 1;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%u: invalid %s: %s\n", path, line_number, key, value);
+            fclose(file);
+            return -1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief Send messages to the scheduler, a client with a full socket buffer is given up
+ */
+static int send_msgs(client_t *client, const msg_t *msgs, uint32_t count) {
+    size_t size = count * sizeof(msg_t);
+    ssize_t n;
+    do {
+        n = write(client->fd, msgs, size);
+    } while (n < 0 && errno == EINTR);
+    if (n != (ssize_t) size) {
+        perror("write");
+        return -1;
+    }
+    msgs_sent += count;
+    writes++;
+    return 0;
+}
+
+/**
+ * @brief Send the RUN and the BLOCK of the next burst of a client, with its HELLO if it is the first one
+ */
+static int send_burst(client_t *client, const workload_t *workload, int first) {
+    msg_t msgs[3];
+    uint32_t count = 0;
+    if (first) {
+        msgs[count++] = (msg_t) {.pid = client->pid, .request = PROCESS_REQUEST_HELLO,
+                                 .time_ms = MSG_PROTOCOL_PIPELINE_VERSION};
+    }
+    msgs[count++] = (msg_t) {.pid = client->pid, .request = PROCESS_REQUEST_RUN,
+                             .time_ms = sample_ms(&workload->cpu_ms, 1), .nice = client->nice};
+    uint32_t io_ms = sample_ms(&workload->io_ms, 0);
+    if (io_ms > 0) {
+        msgs[count++] = (msg_t) {.pid = client->pid, .request = PROCESS_REQUEST_BLOCK, .time_ms = io_ms};
+    }
+    client->outstanding = count - (first ? 1 : 0);
+    return send_msgs(client, msgs, count);
+}
+
+/**
+ * @brief Connect a client and register it in the epoll instance
+ *
+ * @return 0 on success, 1 if the backlog of the scheduler is full, -1 on failure
+ */
+static int connect_client(int epoll_fd, client_t *client) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        int saved_errno = errno;
+        close(fd);
+        if (saved_errno == EAGAIN) return 1;
+        errno = saved_errno;
+        perror("connect");
+        return -1;
+    }
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = client};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        close(fd);
+        return -1;
+    }
+    client->fd = fd;
+    return 0;
+}
+
+static void disconnect_client(client_t *client) {
+    close(client->fd);  // Also removes it from the epoll instance
+    client->fd = -1;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t pct) {
+    uint32_t rank = (uint32_t) (((uint64_t) pct * n + 99) / 100);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static double elapsed_s(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        printf("Usage: %s <workload-spec>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    workload_t workload;
+    if (read_workload(argv[1], &workload) < 0) {
+        return EXIT_FAILURE;
+    }
+    rng_state = workload.seed ? workload.seed : 1;
+
+    // One descriptor per application
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // Draw the whole workload up front, in the order of the arrivals
+    uint32_t n = workload.processes;
+    client_t *clients = calloc(n + 1, sizeof(client_t));
+    if (!clients) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    double arrival_ms = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (workload.arrival_rate > 0 && i > 0) {
+            arrival_ms += -1000.0 / workload.arrival_rate * log(random_unit());
+        }
+        clients[i] = (client_t) {
+            .fd = -1,
+            .pid = PID_BASE + (int32_t) i,
+            .nice = pick_nice(&workload),
+            .arrival_ms = (uint32_t) arrival_ms,
+            .bursts_left = sample_ms(&workload.bursts, 1)
+        };
+    }
+    client_t *pacer = &clients[n];
+    *pacer = (client_t) {.fd = -1, .pid = PID_BASE - 1, .pacer = 1};
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        return EXIT_FAILURE;
+    }
+    struct timespec wall_start;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    uint32_t next_arrival = 0;      // First client not connected yet
+    uint32_t finished = 0;
+    uint32_t failed = 0;
+    uint32_t sim_clock_ms = 0;      // Last time the pacer was woken up, from its first ACK
+    int pacer_waiting = 0;          // The pacer is DONE and waits for the arrivals to connect
+    if (clients[n - 1].arrival_ms > 0) {
+        msg_t hello = {.pid = pacer->pid, .request = PROCESS_REQUEST_HELLO, .time_ms = MSG_PROTOCOL_PIPELINE_VERSION,
+                       .nice = MSG_HELLO_NO_METRICS};
+        if (connect_client(epoll_fd, pacer) != 0 || send_msgs(pacer, &hello, 1) < 0) {
+            fprintf(stderr, "Failed to connect to the scheduler on %s\n", SOCKET_PATH);
+            return EXIT_FAILURE;
+        }
+        pacer_waiting = 1;
+    }
+    struct epoll_event events[MAX_EVENTS];
+    while (finished + failed < n) {
+        // Connect the applications that are due
+        while (next_arrival < n && clients[next_arrival].arrival_ms <= sim_clock_ms) {
+            client_t *client = &clients[next_arrival];
+            int r = connect_client(epoll_fd, client);
+            if (r == 1) break;  // Full backlog, retry a bit later
+            next_arrival++;
+            if (r < 0 || send_burst(client, &workload, 1) < 0) {
+                if (client->fd >= 0) disconnect_client(client);
+                failed++;
+            }
+        }
+        int backlog_full = next_arrival < n && clients[next_arrival].arrival_ms <= sim_clock_ms;
+        // Once they are, the pacer lets the clock go on to the next arrival
+        if (pacer_waiting && !backlog_full) {
+            pacer_waiting = 0;
+            if (next_arrival < n) {
+                msg_t block = {.pid = pacer->pid, .request = PROCESS_REQUEST_BLOCK,
+                               .time_ms = clients[next_arrival].arrival_ms - sim_clock_ms};
+                if (send_msgs(pacer, &block, 1) < 0) {
+                    fprintf(stderr, "The pacer lost the scheduler\n");
+                    return EXIT_FAILURE;
+                }
+                pacer->outstanding = 1;
+            } else {
+                disconnect_client(pacer);
+            }
+        }
+
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, backlog_full ? CONNECT_RETRY_MS : -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return EXIT_FAILURE;
+        }
+        for (int e = 0; e < count; e++) {
+            client_t *client = events[e].data.ptr;
+            ssize_t r = read(client->fd, (char *) client->inbox + client->inbox_bytes,
+                             sizeof(client->inbox) - client->inbox_bytes);
+            if (r < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            if (r <= 0) {
+                if (r < 0) perror("read");
+                fprintf(stderr, "Application %d lost the scheduler\n", client->pid);
+                disconnect_client(client);
+                if (client->pacer) return EXIT_FAILURE;
+                failed++;
+                continue;
+            }
+            reads++;
+            client->inbox_bytes += r;
+            uint32_t received = client->inbox_bytes / sizeof(msg_t);
+            msgs_received += received;
+            for (uint32_t i = 0; i < received && client->fd >= 0; i++) {
+                const msg_t *msg = &client->inbox[i];
+                if (msg->request == PROCESS_REQUEST_HELLO) {
+                    if (msg->time_ms < MSG_PROTOCOL_PIPELINE_VERSION) {
+                        fprintf(stderr, "The scheduler speaks protocol version %u, version %d is required\n",
+                                msg->time_ms, MSG_PROTOCOL_PIPELINE_VERSION);
+                        return EXIT_FAILURE;
+                    }
+                    continue;
+                }
+                if (msg->request == PROCESS_REQUEST_ACK) {
+                    // The first ACK of the pacer is the origin of the arrival times
+                    if (!client->started) {
+                        client->started = 1;
+                        client->start_ms = msg->time_ms;
+                    }
+                    continue;
+                }
+                if (msg->request != PROCESS_REQUEST_DONE || client->outstanding == 0) {
+                    fprintf(stderr, "Application %d received an unexpected %s\n", client->pid,
+                            PROCESS_REQUEST_STRINGS[msg->request]);
+                    continue;
+                }
+                client->finish_ms = msg->time_ms;
+                if (--client->outstanding > 0) continue;
+                if (client->pacer) {
+                    sim_clock_ms = msg->time_ms - client->start_ms;
+                    pacer_waiting = 1;
+                } else if (--client->bursts_left == 0) {
+                    disconnect_client(client);
+                    finished++;
+                } else if (send_burst(client, &workload, 0) < 0) {
+                    disconnect_client(client);
+                    failed++;
+                }
+            }
+            client->inbox_bytes -= received * sizeof(msg_t);
+            memmove(client->inbox, &client->inbox[received], client->inbox_bytes);
+        }
+    }
+    if (pacer->fd >= 0) disconnect_client(pacer);
+    double wall_s = elapsed_s(&wall_start);
+
+    // Summary
+    uint32_t *turnaround_ms = malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+    uint32_t done = 0;
+    uint32_t first_ms = UINT32_MAX;
+    uint32_t last_ms = 0;
+    double sum_ms = 0;
+    for (uint32_t i = 0; i < n && turnaround_ms; i++) {
+        if (clients[i].bursts_left != 0) continue;
+        turnaround_ms[done++] = clients[i].finish_ms - clients[i].start_ms;
+        sum_ms += clients[i].finish_ms - clients[i].start_ms;
+        if (clients[i].start_ms < first_ms) first_ms = clients[i].start_ms;
+        if (clients[i].finish_ms > last_ms) last_ms = clients[i].finish_ms;
+    }
+    printf("%u applications finished, %u failed, simulated from %.3f s to %.3f s in %.3f s of wall time\n",
+           finished, failed, done ? first_ms / 1000.0 : 0.0, last_ms / 1000.0, wall_s);
+    if (done > 0) {
+        qsort(turnaround_ms, done, sizeof(uint32_t), compare_u32);
+        printf("Turnaround (s): mean %.3f, p50 %.3f, p95 %.3f, p99 %.3f\n", sum_ms / done / 1000.0,
+               percentile(turnaround_ms, done, 50) / 1000.0, percentile(turnaround_ms, done, 95) / 1000.0,
+               percentile(turnaround_ms, done, 99) / 1000.0);
+    }
+    printf("Messages: %lu sent in %lu writes, %lu received in %lu reads, %.0f messages/s\n",
+           (unsigned long) msgs_sent, (unsigned long) writes, (unsigned long) msgs_received,
+           (unsigned long) reads, wall_s > 0 ? (msgs_sent + msgs_received) / wall_s : 0.0);
+    if (workload.nice_classes > 0) {
+        // The nice values are sent with every RUN, so STRIDE and LOTTERY favour the low ones
+        printf("Nice mix (applications, mean turnaround):");
+        for (uint32_t c = 0; c < workload.nice_classes; c++) {
+            uint32_t count = 0;
+            uint32_t class_done = 0;
+            double class_sum_ms = 0;
+            for (uint32_t i = 0; i < n; i++) {
+                if (clients[i].nice != workload.nice[c]) continue;
+                count++;
+                if (clients[i].bursts_left == 0) {
+                    class_done++;
+                    class_sum_ms += clients[i].finish_ms - clients[i].start_ms;
+                }
+            }
+            printf(" %d:%u (%.3f s)", workload.nice[c], count, class_done ? class_sum_ms / class_done / 1000.0 : 0.0);
+        }
+        printf("\n");
+    }
+    free(turnaround_ms);
+    free(clients);
+    close(epoll_fd);
+    DBG("Load generator done");
+    return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
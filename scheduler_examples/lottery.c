@@ -0,0 +1,215 @@
+#include "lottery.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msg.h"
+#include "nice.h"
+#include "policy.h"
+
+/**
+ * @brief Add delta tickets to a slot (0-based) in the Fenwick tree
+ */
+static void tree_add(lottery_t *lottery, uint32_t slot, int64_t delta) {
+    for (uint32_t i = slot + 1; i <= lottery->capacity; i += i & (~i + 1)) {
+        lottery->tree[i] += (uint64_t) delta;
+    }
+}
+
+/**
+ * @brief Find the slot holding a ticket, the first one whose prefix sum exceeds it
+ */
+static uint32_t tree_find(const lottery_t *lottery, uint64_t ticket) {
+    uint32_t pos = 0;
+    for (uint32_t step = lottery->capacity; step > 0; step >>= 1) {
+        if (pos + step <= lottery->capacity && lottery->tree[pos + step] <= ticket) {
+            pos += step;
+            ticket -= lottery->tree[pos];
+        }
+    }
+    return pos;     // The slot at the 1-based position pos + 1
+}
+
+/**
+ * @brief Resize the slots to a new capacity and rebuild the tree in O(n)
+ *
+ * Every array is allocated before any is replaced, so on failure the lottery is left as it was.
+ */
+static int lottery_resize(lottery_t *lottery, uint32_t capacity) {
+    pcb_t **pcbs = malloc(capacity * sizeof(pcb_t *));
+    uint32_t *tickets = malloc(capacity * sizeof(uint32_t));
+    uint32_t *free_slots = malloc(capacity * sizeof(uint32_t));
+    uint64_t *tree = malloc((capacity + 1) * sizeof(uint64_t));
+    if (!pcbs || !tickets || !free_slots || !tree) {
+        free(pcbs);
+        free(tickets);
+        free(free_slots);
+        free(tree);
+        return -1;
+    }
+    if (lottery->capacity > 0) {
+        memcpy(pcbs, lottery->pcbs, lottery->capacity * sizeof(pcb_t *));
+        memcpy(tickets, lottery->tickets, lottery->capacity * sizeof(uint32_t));
+        memcpy(free_slots, lottery->free_slots, lottery->n_free * sizeof(uint32_t));
+    }
+    free(lottery->pcbs);
+    free(lottery->tickets);
+    free(lottery->free_slots);
+    free(lottery->tree);
+    lottery->pcbs = pcbs;
+    lottery->tickets = tickets;
+    lottery->free_slots = free_slots;
+    lottery->tree = tree;
+
+    // The new slots are free, pushed so that the lowest ones are used first
+    for (uint32_t slot = capacity; slot > lottery->capacity; slot--) {
+        lottery->pcbs[slot - 1] = NULL;
+        lottery->tickets[slot - 1] = 0;
+        lottery->free_slots[lottery->n_free++] = slot - 1;
+    }
+    lottery->capacity = capacity;
+
+    memset(lottery->tree, 0, (capacity + 1) * sizeof(uint64_t));
+    for (uint32_t i = 1; i <= capacity; i++) {
+        lottery->tree[i] += lottery->tickets[i - 1];
+        uint32_t parent = i + (i & (~i + 1));
+        if (parent <= capacity) lottery->tree[parent] += lottery->tree[i];
+    }
+    return 0;
+}
+
+int lottery_init(lottery_t *lottery, uint32_t capacity) {
+    *lottery = (lottery_t) {.rng = LOTTERY_SEED};
+    uint32_t rounded = 16;
+    while (rounded < capacity && rounded < (1u << 31)) rounded <<= 1;
+    return lottery_resize(lottery, rounded);
+}
+
+void lottery_destroy(lottery_t *lottery) {
+    for (uint32_t slot = 0; slot < lottery->capacity; slot++) {
+        if (lottery->pcbs[slot]) lottery->pcbs[slot]->lottery_slot = LOTTERY_NONE;
+    }
+    free(lottery->pcbs);
+    free(lottery->tickets);
+    free(lottery->free_slots);
+    free(lottery->tree);
+    *lottery = (lottery_t) {0};
+}
+
+int lottery_enqueue(lottery_t *lottery, pcb_t *pcb) {
+    if (pcb_is_queued(pcb)) return 0;
+    if (lottery->n_free == 0) {
+        if (lottery->capacity >= (1u << 31) || lottery_resize(lottery, lottery->capacity * 2) < 0) return 0;
+    }
+    uint32_t slot = lottery->free_slots[--lottery->n_free];
+    uint32_t tickets = nice_to_weight(pcb->nice);
+    lottery->pcbs[slot] = pcb;
+    lottery->tickets[slot] = tickets;
+    tree_add(lottery, slot, tickets);
+    lottery->total_tickets += tickets;
+    lottery->length++;
+    pcb->lottery_slot = slot;
+    return 1;
+}
+
+pcb_t *lottery_remove(lottery_t *lottery, pcb_t *pcb) {
+    uint32_t slot = pcb->lottery_slot;
+    if (slot >= lottery->capacity || lottery->pcbs[slot] != pcb) return NULL;
+    tree_add(lottery, slot, -(int64_t) lottery->tickets[slot]);
+    lottery->total_tickets -= lottery->tickets[slot];
+    lottery->pcbs[slot] = NULL;
+    lottery->tickets[slot] = 0;
+    lottery->free_slots[lottery->n_free++] = slot;
+    lottery->length--;
+    pcb->lottery_slot = LOTTERY_NONE;
+    return pcb;
+}
+
+pcb_t *lottery_dequeue(lottery_t *lottery) {
+    if (lottery->length == 0) return NULL;
+    lottery->rng ^= lottery->rng >> 12;
+    lottery->rng ^= lottery->rng << 25;
+    lottery->rng ^= lottery->rng >> 27;
+    uint64_t ticket = (lottery->rng * 2685821657736338717ull) % lottery->total_tickets;
+    lottery->draws++;
+    return lottery_remove(lottery, lottery->pcbs[tree_find(lottery, ticket)]);
+}
+
+uint32_t lottery_ticks_to_next_event(const pcb_t *cpu_task, uint32_t current_time_ms) {
+    // The quantum ends in the tick at slice_start_ms + LOTTERY_QUANTUM_MS
+    uint32_t end_ms = cpu_task->slice_start_ms + LOTTERY_QUANTUM_MS;
+    return (end_ms >= current_time_ms) ? (end_ms - current_time_ms) / TICKS_MS + 1 : 1;
+}
+
+void lottery_scheduler(uint32_t current_time_ms, lottery_t *lottery, pcb_t **cpu_task) {
+    if (*cpu_task) {
+        pcb_t *task = *cpu_task;
+        task->ellapsed_time_ms += TICKS_MS;
+
+        if (task->ellapsed_time_ms >= task->time_ms) {
+            // Burst finished: the pcb waits for the next command
+            task->status = TASK_COMMAND;
+            *cpu_task = NULL;
+        } else if (current_time_ms - task->slice_start_ms >= LOTTERY_QUANTUM_MS) {
+            // Quantum over: the pcb takes part in the next draw
+            lottery_enqueue(lottery, task);
+            *cpu_task = NULL;
+        }
+    }
+
+    if (*cpu_task == NULL) {
+        *cpu_task = lottery_dequeue(lottery);
+        if (*cpu_task) (*cpu_task)->slice_start_ms = current_time_ms;
+    }
+}
+
+static int lottery_rq_init(void *rq, uint32_t capacity, const scheduler_config_t *config) {
+    return lottery_init(rq, capacity);
+}
+
+static void lottery_rq_destroy(void *rq) {
+    lottery_destroy(rq);
+}
+
+static int lottery_rq_enqueue(void *rq, pcb_t *pcb) {
+    return lottery_enqueue(rq, pcb);
+}
+
+static pcb_t *lottery_rq_pick_next(void *rq) {
+    return lottery_dequeue(rq);
+}
+
+static pcb_t *lottery_rq_remove(void *rq, pcb_t *pcb) {
+    return lottery_remove(rq, pcb);
+}
+
+static uint32_t lottery_rq_length(const void *rq) {
+    return ((const lottery_t *) rq)->length;
+}
+
+static void lottery_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    lottery_scheduler(current_time_ms, rq, cpu_task);
+}
+
+static uint32_t lottery_ticks_to_event(const void *rq, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    return lottery_ticks_to_next_event(cpu_task, current_time_ms);
+}
+
+static void lottery_print_stats(const void *rq) {
+    printf("  LOTTERY: %llu draws\n", (unsigned long long) ((const lottery_t *) rq)->draws);
+}
+
+const scheduler_t LOTTERY_SCHEDULER = {
+    .name = "LOTTERY",
+    .rq_size = sizeof(lottery_t),
+    .init = lottery_rq_init,
+    .destroy = lottery_rq_destroy,
+    .enqueue = lottery_rq_enqueue,
+    .pick_next = lottery_rq_pick_next,
+    .remove = lottery_rq_remove,
+    .length = lottery_rq_length,
+    .tick = lottery_tick,
+    .ticks_to_event = lottery_ticks_to_event,
+    .print_stats = lottery_print_stats,
+};
@@ -0,0 +1,79 @@
+#ifndef LOTTERY_H
+#define LOTTERY_H
+
+#include <stdint.h>
+
+#include "queue.h"
+
+#define LOTTERY_QUANTUM_MS 100
+#define LOTTERY_SEED 0x2545F4914F6CDD1Dull
+
+// The lottery ready queue. Every pcb holds a slot with as many tickets as the weight of its
+// nice value. A Fenwick tree over the slots gives the prefix sums of the tickets, so both
+// changing the tickets of a slot and finding the slot of a winning ticket cost O(log n).
+typedef struct {
+    pcb_t **pcbs;                   // pcb of each slot, NULL if the slot is free
+    uint32_t *tickets;              // Tickets of each slot
+    uint64_t *tree;                 // Fenwick tree of the tickets, 1-based
+    uint32_t *free_slots;           // Stack of the free slots
+    uint32_t n_free;
+    uint32_t capacity;              // Number of slots, a power of two
+    uint32_t length;                // Number of pcbs in the lottery
+    uint64_t total_tickets;
+    uint64_t draws;                 // Number of tickets drawn
+    uint64_t rng;                   // xorshift64* state, seeded with LOTTERY_SEED so runs repeat
+} lottery_t;
+
+/**
+ * @brief Initialize an empty lottery
+ *
+ * The lottery grows on demand, the capacity only avoids reallocations.
+ *
+ * @param capacity The expected number of pcbs
+ * @return 0 on success, -1 on failure
+ */
+int lottery_init(lottery_t *lottery, uint32_t capacity);
+
+/**
+ * @brief Release the memory of a lottery (the pcbs are not freed)
+ */
+void lottery_destroy(lottery_t *lottery);
+
+/**
+ * @brief Add a pcb to the lottery in O(log n), with the tickets of its nice value
+ *
+ * @return 1 on success, 0 on failure
+ */
+int lottery_enqueue(lottery_t *lottery, pcb_t *pcb);
+
+/**
+ * @brief Take a pcb out of the lottery in O(log n)
+ *
+ * @return The pcb, or NULL if it was not in this lottery
+ */
+pcb_t *lottery_remove(lottery_t *lottery, pcb_t *pcb);
+
+/**
+ * @brief Draw a ticket and take the pcb holding it out of the lottery, in O(log n)
+ *
+ * @return The pcb, or NULL if the lottery is empty
+ */
+pcb_t *lottery_dequeue(lottery_t *lottery);
+
+/**
+ * @brief Number of ticks until the running pcb uses up its quantum, at least 1
+ *
+ * @param current_time_ms The time of the next tick
+ */
+uint32_t lottery_ticks_to_next_event(const pcb_t *cpu_task, uint32_t current_time_ms);
+
+/**
+ * @brief Lottery scheduling algorithm
+ *
+ * At the end of every quantum of LOTTERY_QUANTUM_MS the running pcb goes back to the lottery
+ * and a ticket is drawn among all the ready pcbs. Each pcb wins with a probability
+ * proportional to the weight of its nice value.
+ */
+void lottery_scheduler(uint32_t current_time_ms, lottery_t *lottery, pcb_t **cpu_task);
+
+#endif //LOTTERY_H
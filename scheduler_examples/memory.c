@@ -0,0 +1,231 @@
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_TABLE_MIN_CAPACITY 16
+
+const replacement_t *const REPLACEMENTS[] = {
+    &FIFO_REPLACEMENT,
+    &LRU_REPLACEMENT,
+    &CLOCK_REPLACEMENT,
+    &TWO_LIST_REPLACEMENT,
+    NULL
+};
+
+const replacement_t *get_replacement(const char *name) {
+    for (int i = 0; REPLACEMENTS[i] != NULL; i++) {
+        if (strcmp(name, REPLACEMENTS[i]->name) == 0) {
+            return REPLACEMENTS[i];
+        }
+    }
+    return NULL;
+}
+
+void memory_config_default(memory_config_t *config) {
+    *config = (memory_config_t) {
+        .frames = 0,
+        .fault_ms = MEMORY_DEFAULT_FAULT_MS,
+        .replacement = &LRU_REPLACEMENT
+    };
+}
+
+void frame_list_push(memory_t *memory, uint32_t list, frame_t *frame) {
+    frame_list_t *l = &memory->lists[list];
+    frame->list = list;
+    frame->next = NULL;
+    frame->prev = l->tail;
+    if (l->tail) {
+        l->tail->next = frame;
+    } else {
+        l->head = frame;
+    }
+    l->tail = frame;
+    l->length++;
+}
+
+void frame_list_remove(memory_t *memory, frame_t *frame) {
+    if (frame->list == FRAME_LIST_NONE) return;
+    frame_list_t *l = &memory->lists[frame->list];
+    if (frame->prev) {
+        frame->prev->next = frame->next;
+    } else {
+        l->head = frame->next;
+    }
+    if (frame->next) {
+        frame->next->prev = frame->prev;
+    } else {
+        l->tail = frame->prev;
+    }
+    frame->prev = NULL;
+    frame->next = NULL;
+    frame->list = FRAME_LIST_NONE;
+    l->length--;
+}
+
+int memory_init(memory_t *memory, const memory_config_t *config) {
+    *memory = (memory_t) {0};
+    if (config) {
+        memory->config = *config;
+    } else {
+        memory_config_default(&memory->config);
+    }
+    if (!memory->config.replacement) memory->config.replacement = &LRU_REPLACEMENT;
+    if (memory->config.frames == 0) return 0;
+
+    memory->frames = calloc(memory->config.frames, sizeof(frame_t));
+    if (!memory->frames) return -1;
+    for (uint32_t i = 0; i < memory->config.frames; i++) {
+        memory->frames[i].list = FRAME_LIST_NONE;
+        frame_list_push(memory, FRAME_LIST_FREE, &memory->frames[i]);
+    }
+    return 0;
+}
+
+void memory_destroy(memory_t *memory) {
+    free(memory->frames);
+    memory->frames = NULL;
+}
+
+static uint32_t page_slot(const page_table_t *table, uint32_t page) {
+    return (page * 2654435761u) & (table->capacity - 1);
+}
+
+/**
+ * @brief Find the entry of a page, NULL if the pcb never touched it
+ */
+static pte_t *page_table_find(page_table_t *table, uint32_t page) {
+    for (uint32_t i = page_slot(table, page); ; i = (i + 1) & (table->capacity - 1)) {
+        pte_t *entry = &table->entries[i];
+        if (entry->page == page) return entry;
+        if (entry->page == PAGE_NONE) return NULL;
+    }
+}
+
+static int page_table_resize(page_table_t *table, uint32_t capacity) {
+    pte_t *entries = malloc(capacity * sizeof(pte_t));
+    if (!entries) return -1;
+    for (uint32_t i = 0; i < capacity; i++) {
+        entries[i] = (pte_t) {.page = PAGE_NONE, .frame = FRAME_NONE};
+    }
+    page_table_t resized = {.entries = entries, .capacity = capacity, .count = table->count};
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        if (table->entries[i].page == PAGE_NONE) continue;
+        uint32_t slot = page_slot(&resized, table->entries[i].page);
+        while (entries[slot].page != PAGE_NONE) slot = (slot + 1) & (capacity - 1);
+        entries[slot] = table->entries[i];
+    }
+    free(table->entries);
+    *table = resized;
+    return 0;
+}
+
+/**
+ * @brief Find the entry of a page, adding an invalid one the first time the page is touched
+ *
+ * @return The entry, or NULL if the table could not grow
+ */
+static pte_t *page_table_get(page_table_t *table, uint32_t page) {
+    pte_t *entry = page_table_find(table, page);
+    if (entry) return entry;
+    // Keep the load under one half, so the probes stay short
+    if (2 * (table->count + 1) > table->capacity && page_table_resize(table, 2 * table->capacity) < 0) {
+        return NULL;
+    }
+    uint32_t slot = page_slot(table, page);
+    while (table->entries[slot].page != PAGE_NONE) slot = (slot + 1) & (table->capacity - 1);
+    table->entries[slot].page = page;
+    table->count++;
+    return &table->entries[slot];
+}
+
+static page_table_t *page_table_new(void) {
+    page_table_t *table = calloc(1, sizeof(page_table_t));
+    if (!table) return NULL;
+    if (page_table_resize(table, PAGE_TABLE_MIN_CAPACITY) < 0) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+/**
+ * @brief Take a frame for a page that faulted: a free one, or the victim of the replacement policy
+ */
+static frame_t *take_frame(memory_t *memory) {
+    frame_t *frame = memory->lists[FRAME_LIST_FREE].head;
+    if (frame) {
+        frame_list_remove(memory, frame);
+        return frame;
+    }
+    frame = memory->config.replacement->victim(memory);
+    // Unmap the page of the previous owner
+    pte_t *entry = page_table_find(frame->owner->page_table, frame->page);
+    if (entry) entry->frame = FRAME_NONE;
+    memory->evictions++;
+    return frame;
+}
+
+void memory_dispatch(memory_t *memory, pcb_t *pcb) {
+    if (!memory->frames || pcb->n_pages == 0) return;
+    if (!pcb->page_table && !(pcb->page_table = page_table_new())) {
+        perror("page_table_new");
+        return;
+    }
+
+    const replacement_t *replacement = memory->config.replacement;
+    uint32_t faults = 0;
+    for (uint32_t i = 0; i < pcb->n_pages; i++) {
+        memory->references++;
+        // The table grows before any eviction, which only updates entries in place
+        pte_t *entry = page_table_get(pcb->page_table, pcb->pages[i]);
+        if (!entry) {
+            perror("page_table_get");
+            break;
+        }
+        if (entry->frame != FRAME_NONE) {
+            if (replacement->referenced) replacement->referenced(memory, &memory->frames[entry->frame]);
+            continue;
+        }
+        faults++;
+        frame_t *frame = take_frame(memory);
+        frame->owner = pcb;
+        frame->page = pcb->pages[i];
+        frame->referenced = 0;
+        entry->frame = (uint32_t) (frame - memory->frames);
+        replacement->loaded(memory, frame);
+    }
+    memory->faults += faults;
+    memory->fault_ms += (uint64_t) faults * memory->config.fault_ms;
+    pcb->page_faults += faults;
+    pcb->time_ms += faults * memory->config.fault_ms;
+    pcb->pages = NULL;
+    pcb->n_pages = 0;
+}
+
+void memory_release(memory_t *memory, pcb_t *pcb) {
+    page_table_t *table = pcb->page_table;
+    if (!table) return;
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        uint32_t f = table->entries[i].frame;
+        if (table->entries[i].page == PAGE_NONE || f == FRAME_NONE) continue;
+        frame_t *frame = &memory->frames[f];
+        if (memory->config.replacement->released) memory->config.replacement->released(memory, frame);
+        frame->owner = NULL;
+        frame_list_push(memory, FRAME_LIST_FREE, frame);
+    }
+    free(table->entries);
+    free(table);
+    pcb->page_table = NULL;
+}
+
+void memory_print_stats(const memory_t *memory) {
+    if (!memory->frames) return;
+    printf("Memory: %u frames (%s), %u in use, %llu references, %llu faults (%.1f%%), %llu evictions, "
+           "%llu ms charged\n", memory->config.frames, memory->config.replacement->name,
+           memory->config.frames - memory->lists[FRAME_LIST_FREE].length,
+           (unsigned long long) memory->references, (unsigned long long) memory->faults,
+           memory->references > 0 ? 100.0 * (double) memory->faults / (double) memory->references : 0.0,
+           (unsigned long long) memory->evictions, (unsigned long long) memory->fault_ms);
+}
@@ -0,0 +1,161 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdint.h>
+
+#include "queue.h"
+
+/*
+ * Paging: a fixed number of physical frames shared by all the applications, a page table per
+ * pcb and a pluggable page replacement policy.
+ *
+ * Every burst may list the pages it uses (see burst_t). The first time a burst is dispatched,
+ * it touches its pages in order: the resident ones are hits, the others are loaded into a
+ * free frame, or into the frame of the victim chosen by the replacement policy. Each fault
+ * adds the fault latency to the burst, so a pcb pays for the pages that other pcbs took from
+ * it while it was blocked or waiting. Charging once, when the burst starts, keeps the cost
+ * known before the burst runs, so virtual time can still skip to its end, and keeps every
+ * burst finite even when the slices are shorter than the faults.
+ *
+ * With no frames (the default) paging is off and the pages of the bursts are ignored.
+ */
+
+#define FRAME_NONE UINT32_MAX       // Frame of a page that is not resident
+#define PAGE_NONE UINT32_MAX        // Page of an empty page table entry
+
+#define MEMORY_DEFAULT_FAULT_MS 10  // Latency of a page fault, one tick
+
+typedef struct replacement_st replacement_t;
+
+typedef struct {
+    uint32_t frames;                // Number of physical frames, 0 to turn paging off
+    uint32_t fault_ms;              // Time added to the burst for each page fault
+    const replacement_t *replacement;   // The page replacement policy
+} memory_config_t;
+
+// A physical frame, linked in the lists of the replacement policy or in the free list
+typedef struct frame_st {
+    pcb_t *owner;                   // The pcb whose page is in the frame, NULL if the frame is free
+    uint32_t page;                  // The page in the frame
+    uint32_t referenced;            // Reference bit, set on every access (CLOCK, 2LIST)
+    uint32_t list;                  // The list the frame is in, FRAME_LIST_*
+    struct frame_st *prev;
+    struct frame_st *next;
+} frame_t;
+
+enum {
+    FRAME_LIST_FREE = 0,
+    FRAME_LIST_RESIDENT,            // Load order (FIFO), recency order (LRU) or inactive list (2LIST)
+    FRAME_LIST_ACTIVE,              // Active list (2LIST)
+    FRAME_LISTS,
+    FRAME_LIST_NONE = FRAME_LISTS   // In no list (CLOCK keeps its frames in place)
+};
+
+// Doubly linked list through the frames, oldest first
+typedef struct {
+    frame_t *head;
+    frame_t *tail;
+    uint32_t length;
+} frame_list_t;
+
+// Page table entry, the mapping is valid while frame is not FRAME_NONE
+typedef struct {
+    uint32_t page;                  // PAGE_NONE if the entry is empty
+    uint32_t frame;
+} pte_t;
+
+// Page table of a pcb: open addressing with linear probing on the page number. Evicted
+// pages keep their entry with FRAME_NONE, so entries are only removed with the table.
+typedef struct page_table_st {
+    pte_t *entries;
+    uint32_t capacity;              // A power of two
+    uint32_t count;                 // Entries in use
+} page_table_t;
+
+typedef struct memory_st {
+    memory_config_t config;
+    frame_t *frames;
+    frame_list_t lists[FRAME_LISTS];
+    uint32_t hand;                  // Next frame the clock looks at (CLOCK)
+    // Statistics
+    uint64_t references;            // Pages touched
+    uint64_t faults;                // References to a page that was not resident
+    uint64_t evictions;             // Faults that took the frame of another page
+    uint64_t fault_ms;              // Time charged to the bursts for the faults
+} memory_t;
+
+struct replacement_st {
+    const char *name;
+    // A page was loaded in a frame that was free
+    void (*loaded)(memory_t *memory, frame_t *frame);
+    // Optional, a resident page was referenced again
+    void (*referenced)(memory_t *memory, frame_t *frame);
+    // Choose the frame to evict when none is free and take it out of the lists of the policy
+    frame_t *(*victim)(memory_t *memory);
+    // Optional, take a frame out of the lists of the policy, its owner left
+    void (*released)(memory_t *memory, frame_t *frame);
+};
+
+// The replacement policies, see replacement.c
+extern const replacement_t FIFO_REPLACEMENT;
+extern const replacement_t LRU_REPLACEMENT;
+extern const replacement_t CLOCK_REPLACEMENT;
+extern const replacement_t TWO_LIST_REPLACEMENT;
+
+// All replacement policies, terminated by NULL
+extern const replacement_t *const REPLACEMENTS[];
+
+/**
+ * @brief Find a replacement policy by name
+ *
+ * @return The policy, or NULL if there is none with that name
+ */
+const replacement_t *get_replacement(const char *name);
+
+/**
+ * @brief Fill a configuration with the defaults: paging off, LRU replacement
+ */
+void memory_config_default(memory_config_t *config);
+
+/**
+ * @brief Allocate the frames, all of them free
+ *
+ * @param config The configuration, or NULL for the defaults
+ * @return 0 on success, -1 on failure
+ */
+int memory_init(memory_t *memory, const memory_config_t *config);
+
+/**
+ * @brief Release the frames (the page tables are released with their pcbs)
+ */
+void memory_destroy(memory_t *memory);
+
+/**
+ * @brief Touch the pages of the burst of a pcb that was just dispatched
+ *
+ * The faults are added to pcb->time_ms, and to pcb->page_faults. The pages are only touched
+ * by the first dispatch of the burst, pcb->n_pages is cleared once they are.
+ */
+void memory_dispatch(memory_t *memory, pcb_t *pcb);
+
+/**
+ * @brief Free the frames and the page table of a pcb that leaves the simulation
+ */
+void memory_release(memory_t *memory, pcb_t *pcb);
+
+/**
+ * @brief Print the use of the frames and the fault rate
+ */
+void memory_print_stats(const memory_t *memory);
+
+/**
+ * @brief Append a frame at the tail of a list
+ */
+void frame_list_push(memory_t *memory, uint32_t list, frame_t *frame);
+
+/**
+ * @brief Take a frame out of the list it is in
+ */
+void frame_list_remove(memory_t *memory, frame_t *frame);
+
+#endif //MEMORY_H
@@ -0,0 +1,151 @@
+#include "metrics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void metrics_arrival(pcb_t *pcb, uint32_t current_time_ms) {
+    pcb->arrival_time_ms = current_time_ms;
+    pcb->completion_time_ms = current_time_ms;
+}
+
+void metrics_ready(pcb_t *pcb, uint32_t current_time_ms) {
+    pcb->state_since_ms = current_time_ms;
+}
+
+void metrics_dispatch(pcb_t *pcb, uint32_t current_time_ms) {
+    if (pcb->first_run_time_ms == METRICS_NONE) {
+        pcb->first_run_time_ms = current_time_ms;
+    }
+    pcb->ready_wait_ms += current_time_ms - pcb->state_since_ms;
+}
+
+void metrics_burst_done(pcb_t *pcb, uint32_t current_time_ms) {
+    pcb->cpu_ms += pcb->ellapsed_time_ms;
+    pcb->completion_time_ms = current_time_ms;
+}
+
+void metrics_blocked(pcb_t *pcb, uint32_t current_time_ms) {
+    pcb->state_since_ms = current_time_ms;
+}
+
+void metrics_unblocked(pcb_t *pcb, uint32_t current_time_ms) {
+    pcb->blocked_ms += current_time_ms - pcb->state_since_ms;
+    pcb->completion_time_ms = current_time_ms;
+}
+
+void metrics_init(metrics_t *metrics) {
+    *metrics = (metrics_t) {0};
+}
+
+void metrics_destroy(metrics_t *metrics) {
+    free(metrics->records);
+    *metrics = (metrics_t) {0};
+}
+
+int metrics_record(metrics_t *metrics, const pcb_t *pcb) {
+    if (pcb->completion_time_ms == pcb->arrival_time_ms && pcb->first_run_time_ms == METRICS_NONE) {
+        return 0;   // Connected and left without doing anything
+    }
+    if (metrics->count == metrics->capacity) {
+        uint32_t capacity = metrics->capacity ? metrics->capacity * 2 : 64;
+        metrics_record_t *records = realloc(metrics->records, capacity * sizeof(metrics_record_t));
+        if (!records) return -1;
+        metrics->records = records;
+        metrics->capacity = capacity;
+    }
+    metrics->records[metrics->count++] = (metrics_record_t) {
+        .pid = pcb->pid,
+        .arrival_time_ms = pcb->arrival_time_ms,
+        .first_run_time_ms = pcb->first_run_time_ms,
+        .completion_time_ms = pcb->completion_time_ms,
+        .ready_wait_ms = pcb->ready_wait_ms,
+        .blocked_ms = pcb->blocked_ms,
+        .cpu_ms = pcb->cpu_ms
+    };
+    return 0;
+}
+
+double metrics_mean_turnaround_ms(const metrics_t *metrics) {
+    if (metrics->count == 0) return 0;
+    double sum_ms = 0;
+    for (uint32_t i = 0; i < metrics->count; i++) {
+        sum_ms += metrics->records[i].completion_time_ms - metrics->records[i].arrival_time_ms;
+    }
+    return sum_ms / metrics->count;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Value at a percentile of sorted values, nearest-rank method
+ */
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t pct) {
+    uint32_t rank = (uint32_t) (((uint64_t) pct * n + 99) / 100);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * @brief Print the mean and percentiles of a set of times, sorting them in place
+ */
+static void print_distribution(const char *name, uint32_t *values_ms, uint32_t n) {
+    if (n == 0) {
+        printf("%-12s %10s\n", name, "-");
+        return;
+    }
+    double sum_ms = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum_ms += values_ms[i];
+    }
+    qsort(values_ms, n, sizeof(uint32_t), compare_u32);
+    printf("%-12s %10.3f %10.3f %10.3f %10.3f\n", name, sum_ms / n / 1000.0,
+           percentile(values_ms, n, 50) / 1000.0, percentile(values_ms, n, 95) / 1000.0,
+           percentile(values_ms, n, 99) / 1000.0);
+}
+
+void metrics_print_summary(const metrics_t *metrics, const machine_t *machine, uint32_t elapsed_ms) {
+    uint32_t n = metrics->count;
+    printf("Metrics of %u applications over %.3f s\n", n, elapsed_ms / 1000.0);
+    uint32_t *values_ms = malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+    if (!values_ms) {
+        perror("malloc");
+        return;
+    }
+    printf("%-12s %10s %10s %10s %10s\n", "Time (s)", "mean", "p50", "p95", "p99");
+    for (uint32_t i = 0; i < n; i++) {
+        values_ms[i] = metrics->records[i].completion_time_ms - metrics->records[i].arrival_time_ms;
+    }
+    print_distribution("Turnaround", values_ms, n);
+
+    // Applications that never ran have no response time
+    uint32_t n_ran = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (metrics->records[i].first_run_time_ms != METRICS_NONE) {
+            values_ms[n_ran++] = metrics->records[i].first_run_time_ms - metrics->records[i].arrival_time_ms;
+        }
+    }
+    print_distribution("Response", values_ms, n_ran);
+
+    for (uint32_t i = 0; i < n; i++) {
+        values_ms[i] = metrics->records[i].ready_wait_ms;
+    }
+    print_distribution("Wait", values_ms, n);
+    free(values_ms);
+
+    uint64_t busy_ms = 0;
+    uint64_t dispatches = 0;
+    uint64_t preemptions = 0;
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        busy_ms += machine->cores[i].busy_ms;
+        dispatches += machine->cores[i].dispatches;
+        preemptions += machine->cores[i].preemptions;
+    }
+    double utilisation = (elapsed_ms > 0 && machine->n_cores > 0) ?
+        100.0 * (double) busy_ms / machine->n_cores / elapsed_ms : 0.0;
+    double throughput = (elapsed_ms > 0) ? n / (elapsed_ms / 1000.0) : 0.0;
+    printf("CPU utilisation %.1f%%, throughput %.3f apps/s, %lu context switches (%lu preemptions)\n",
+           utilisation, throughput, (unsigned long) dispatches, (unsigned long) preemptions);
+}
@@ -0,0 +1,81 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#include "queue.h"
+#include "scheduler.h"
+
+/*
+ * Scheduling metrics collected on the scheduler side. Each pcb records its arrival,
+ * first dispatch and completion, and the time it spent waiting in the ready queues,
+ * blocked and running. The transitions are reported with the metrics_* hooks below.
+ * When an application leaves, its pcb is copied into a metrics_t, which summarises
+ * the run with the mean and percentiles of the turnaround, response and waiting times.
+ */
+
+#define METRICS_NONE UINT32_MAX     // first_run_time_ms of a pcb that never ran
+
+// What is left of a pcb once its application is gone
+typedef struct {
+    int32_t pid;
+    uint32_t arrival_time_ms;
+    uint32_t first_run_time_ms;
+    uint32_t completion_time_ms;
+    uint32_t ready_wait_ms;
+    uint32_t blocked_ms;
+    uint32_t cpu_ms;
+} metrics_record_t;
+
+typedef struct {
+    metrics_record_t *records;
+    uint32_t count;         // Number of records
+    uint32_t capacity;      // Number of allocated records
+} metrics_t;
+
+// Transitions of a pcb, called by the simulators and the machine
+void metrics_arrival(pcb_t *pcb, uint32_t current_time_ms);
+void metrics_ready(pcb_t *pcb, uint32_t current_time_ms);
+void metrics_dispatch(pcb_t *pcb, uint32_t current_time_ms);
+void metrics_burst_done(pcb_t *pcb, uint32_t current_time_ms);
+void metrics_blocked(pcb_t *pcb, uint32_t current_time_ms);
+void metrics_unblocked(pcb_t *pcb, uint32_t current_time_ms);
+
+/**
+ * @brief Initialize an empty collector
+ */
+void metrics_init(metrics_t *metrics);
+
+/**
+ * @brief Release the records of a collector
+ */
+void metrics_destroy(metrics_t *metrics);
+
+/**
+ * @brief Keep the metrics of a pcb whose application is gone
+ *
+ * Applications that never completed a request are not recorded.
+ *
+ * @return 0 on success, -1 if the record could not be allocated
+ */
+int metrics_record(metrics_t *metrics, const pcb_t *pcb);
+
+/**
+ * @brief Mean turnaround time of the recorded applications, in milliseconds
+ */
+double metrics_mean_turnaround_ms(const metrics_t *metrics);
+
+/**
+ * @brief Print the summary of a run
+ *
+ * Mean, p50, p95 and p99 of the turnaround (arrival to completion), response
+ * (arrival to first dispatch) and waiting (total time in the ready queues) times,
+ * followed by the CPU utilisation, the throughput and the context switches.
+ *
+ * @param metrics The recorded applications
+ * @param machine The cores the applications ran on
+ * @param elapsed_ms The simulated time of the run
+ */
+void metrics_print_summary(const metrics_t *metrics, const machine_t *machine, uint32_t elapsed_ms);
+
+#endif //METRICS_H
@@ -0,0 +1,234 @@
+#include "mlfq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "msg.h"
+#include "policy.h"
+
+/**
+ * @brief Quantum of a level that has no value configured: double the one above, saturating
+ */
+static uint32_t doubled_quantum(uint32_t quantum_ms) {
+    return (quantum_ms > UINT32_MAX / 2) ? UINT32_MAX : quantum_ms * 2;
+}
+
+void mlfq_config_default(mlfq_config_t *config) {
+    config->levels = MLFQ_DEFAULT_LEVELS;
+    config->quantum_ms[0] = MLFQ_DEFAULT_QUANTUM_MS;
+    for (uint32_t i = 1; i < MLFQ_MAX_LEVELS; i++) {
+        config->quantum_ms[i] = doubled_quantum(config->quantum_ms[i - 1]);
+    }
+    config->boost_interval_ms = MLFQ_DEFAULT_BOOST_MS;
+}
+
+int mlfq_config_set_levels(mlfq_config_t *config, uint32_t levels) {
+    if (levels < 1 || levels > MLFQ_MAX_LEVELS) return -1;
+    for (uint32_t i = config->levels; i < levels; i++) {
+        config->quantum_ms[i] = doubled_quantum(config->quantum_ms[i - 1]);
+    }
+    config->levels = levels;
+    return 0;
+}
+
+int mlfq_config_parse_quanta(mlfq_config_t *config, const char *list) {
+    uint32_t quantum_ms[MLFQ_MAX_LEVELS];
+    uint32_t n = 0;
+    const char *p = list;
+    while (*p) {
+        char *end;
+        unsigned long value = strtoul(p, &end, 10);
+        if (end == p || value == 0 || value > UINT32_MAX || n == MLFQ_MAX_LEVELS) return -1;
+        quantum_ms[n++] = (uint32_t) value;
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+    if (n == 0) return -1;
+
+    // The list may configure more levels than there are, never fewer
+    if (n > config->levels) config->levels = n;
+    for (uint32_t i = 0; i < MLFQ_MAX_LEVELS; i++) {
+        config->quantum_ms[i] = (i < n) ? quantum_ms[i] : doubled_quantum(config->quantum_ms[i - 1]);
+    }
+    return 0;
+}
+
+void mlfq_init(mlfq_t *mlfq, const mlfq_config_t *config) {
+    *mlfq = (mlfq_t) {0};
+    if (config) {
+        mlfq->config = *config;
+    } else {
+        mlfq_config_default(&mlfq->config);
+    }
+    mlfq->next_boost_ms = mlfq->config.boost_interval_ms;
+}
+
+int mlfq_enqueue(mlfq_t *mlfq, pcb_t *pcb) {
+    if (pcb->mlfq_epoch != mlfq->epoch) {
+        // There was a boost since the pcb last entered the queues
+        pcb->mlfq_level = 0;
+        pcb->mlfq_used_ms = 0;
+        pcb->mlfq_epoch = mlfq->epoch;
+    }
+    if (!enqueue_pcb(&mlfq->queues[pcb->mlfq_level], pcb)) return 0;
+    mlfq->nonempty |= 1u << pcb->mlfq_level;
+    mlfq->length++;
+    return 1;
+}
+
+pcb_t *mlfq_remove(mlfq_t *mlfq, pcb_t *pcb) {
+    queue_t *q = &mlfq->queues[pcb->mlfq_level];
+    if (pcb->queue != q) return NULL;
+    remove_pcb(q, pcb);
+    if (q->length == 0) mlfq->nonempty &= ~(1u << pcb->mlfq_level);
+    mlfq->length--;
+    return pcb;
+}
+
+pcb_t *mlfq_dequeue(mlfq_t *mlfq) {
+    if (mlfq->nonempty == 0) return NULL;
+    uint32_t level = (uint32_t) __builtin_ctz(mlfq->nonempty);
+    pcb_t *pcb = dequeue_pcb(&mlfq->queues[level]);
+    if (mlfq->queues[level].length == 0) mlfq->nonempty &= ~(1u << level);
+    mlfq->length--;
+    return pcb;
+}
+
+/**
+ * @brief Move every pcb to level 0 and reset the CPU time they used
+ *
+ * Pcbs outside the queues (blocked or waiting for a command) are reset lazily by
+ * mlfq_enqueue(), through the boost epoch.
+ */
+static void mlfq_boost(mlfq_t *mlfq, pcb_t *cpu_task, uint32_t current_time_ms) {
+    mlfq->epoch++;
+    for (uint32_t level = 1; level < mlfq->config.levels; level++) {
+        pcb_t *pcb;
+        while ((pcb = dequeue_pcb(&mlfq->queues[level])) != NULL) {
+            pcb->mlfq_level = 0;
+            enqueue_pcb(&mlfq->queues[0], pcb);
+        }
+    }
+    for (pcb_t *pcb = mlfq->queues[0].head; pcb != NULL; pcb = pcb->next) {
+        pcb->mlfq_used_ms = 0;
+        pcb->mlfq_epoch = mlfq->epoch;
+    }
+    mlfq->nonempty = (mlfq->queues[0].length > 0) ? 1u : 0u;
+    if (cpu_task) {
+        cpu_task->mlfq_level = 0;
+        cpu_task->mlfq_used_ms = 0;
+        cpu_task->mlfq_epoch = mlfq->epoch;
+    }
+    // Boosts happen at fixed multiples of the interval, even if ticks were skipped
+    while (mlfq->next_boost_ms <= current_time_ms) {
+        mlfq->next_boost_ms += mlfq->config.boost_interval_ms;
+    }
+}
+
+uint32_t mlfq_ticks_to_next_event(const mlfq_t *mlfq, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    // A pcb of a higher level preempts the running one in the next tick
+    if (mlfq->nonempty & ((1u << cpu_task->mlfq_level) - 1)) return 1;
+
+    uint32_t quantum_ms = mlfq->config.quantum_ms[cpu_task->mlfq_level];
+    uint32_t left_ms = (quantum_ms > cpu_task->mlfq_used_ms) ? quantum_ms - cpu_task->mlfq_used_ms : 0;
+    uint32_t ticks = (left_ms + TICKS_MS - 1) / TICKS_MS;
+    if (mlfq->config.boost_interval_ms > 0) {
+        // The boost happens in the first tick at or after next_boost_ms
+        uint32_t boost_ticks = 1;
+        if (mlfq->next_boost_ms > current_time_ms) {
+            boost_ticks += (mlfq->next_boost_ms - current_time_ms + TICKS_MS - 1) / TICKS_MS;
+        }
+        if (boost_ticks < ticks) ticks = boost_ticks;
+    }
+    return (ticks > 0) ? ticks : 1;
+}
+
+void mlfq_scheduler(uint32_t current_time_ms, mlfq_t *mlfq, pcb_t **cpu_task) {
+    if (*cpu_task) {
+        pcb_t *task = *cpu_task;
+        task->ellapsed_time_ms += TICKS_MS;
+        task->mlfq_used_ms += TICKS_MS;
+
+        if (task->ellapsed_time_ms >= task->time_ms) {
+            // Burst finished: the pcb keeps its level and waits for the next command
+            task->status = TASK_COMMAND;
+            *cpu_task = NULL;
+        } else if (task->mlfq_used_ms >= mlfq->config.quantum_ms[task->mlfq_level]) {
+            // Quantum exhausted: demote, the lowest level is plain round robin
+            if (task->mlfq_level + 1 < mlfq->config.levels) task->mlfq_level++;
+            task->mlfq_used_ms = 0;
+            mlfq_enqueue(mlfq, task);
+            *cpu_task = NULL;
+        }
+    }
+
+    if (mlfq->config.boost_interval_ms > 0 && current_time_ms >= mlfq->next_boost_ms) {
+        mlfq_boost(mlfq, *cpu_task, current_time_ms);
+    }
+
+    // Preempt the running pcb if a higher level has pcbs waiting
+    if (*cpu_task && (mlfq->nonempty & ((1u << (*cpu_task)->mlfq_level) - 1))) {
+        mlfq_enqueue(mlfq, *cpu_task);
+        *cpu_task = NULL;
+    }
+
+    if (*cpu_task == NULL) {
+        *cpu_task = mlfq_dequeue(mlfq);
+    }
+}
+
+static int mlfq_rq_init(void *rq, uint32_t capacity, const scheduler_config_t *config) {
+    mlfq_init(rq, config ? &config->mlfq : NULL);
+    return 0;
+}
+
+static int mlfq_rq_enqueue(void *rq, pcb_t *pcb) {
+    return mlfq_enqueue(rq, pcb);
+}
+
+static pcb_t *mlfq_rq_pick_next(void *rq) {
+    return mlfq_dequeue(rq);
+}
+
+static pcb_t *mlfq_rq_remove(void *rq, pcb_t *pcb) {
+    return mlfq_remove(rq, pcb);
+}
+
+static uint32_t mlfq_rq_length(const void *rq) {
+    return ((const mlfq_t *) rq)->length;
+}
+
+static void mlfq_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    mlfq_scheduler(current_time_ms, rq, cpu_task);
+}
+
+static uint32_t mlfq_ticks_to_event(const void *rq, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    return mlfq_ticks_to_next_event(rq, cpu_task, current_time_ms);
+}
+
+static void mlfq_skip(void *rq, pcb_t *cpu_task, uint32_t skipped_ms) {
+    cpu_task->mlfq_used_ms += skipped_ms;
+}
+
+static void mlfq_print_stats(const void *rq) {
+    const mlfq_t *mlfq = rq;
+    printf("  MLFQ: %u levels, %u boosts\n", mlfq->config.levels, mlfq->epoch);
+}
+
+const scheduler_t MLFQ_SCHEDULER = {
+    .name = "MLFQ",
+    .rq_size = sizeof(mlfq_t),
+    .init = mlfq_rq_init,
+    .enqueue = mlfq_rq_enqueue,
+    .pick_next = mlfq_rq_pick_next,
+    .remove = mlfq_rq_remove,
+    .length = mlfq_rq_length,
+    .tick = mlfq_tick,
+    .ticks_to_event = mlfq_ticks_to_event,
+    .skip = mlfq_skip,
+    .print_stats = mlfq_print_stats,
+};
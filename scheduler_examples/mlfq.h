@@ -0,0 +1,108 @@
+#ifndef MLFQ_H
+#define MLFQ_H
+
+#include <stdint.h>
+
+#include "queue.h"
+
+#define MLFQ_MAX_LEVELS 32          // One bit per level in the non-empty bitmap
+#define MLFQ_DEFAULT_LEVELS 3
+#define MLFQ_DEFAULT_QUANTUM_MS 500 // Time slice of level 0, each level below doubles it
+#define MLFQ_DEFAULT_BOOST_MS 5000
+
+typedef struct {
+    uint32_t levels;                        // Number of priority levels, 0 is the highest
+    uint32_t quantum_ms[MLFQ_MAX_LEVELS];   // CPU time a pcb may use at each level before being demoted
+    uint32_t boost_interval_ms;             // Period of the priority boost, 0 to disable it
+} mlfq_config_t;
+
+// The MLFQ ready queues
+typedef struct {
+    mlfq_config_t config;
+    queue_t queues[MLFQ_MAX_LEVELS];
+    uint32_t nonempty;              // Bit i is set when queues[i] is not empty
+    uint32_t length;                // Number of pcbs in all levels
+    uint32_t epoch;                 // Number of boosts so far
+    uint32_t next_boost_ms;         // Time of the next priority boost
+} mlfq_t;
+
+/**
+ * @brief Fill a configuration with the default values
+ *
+ * MLFQ_DEFAULT_LEVELS levels, a quantum of MLFQ_DEFAULT_QUANTUM_MS doubled at every level
+ * and a boost every MLFQ_DEFAULT_BOOST_MS.
+ */
+void mlfq_config_default(mlfq_config_t *config);
+
+/**
+ * @brief Set the number of levels of a configuration
+ *
+ * Quanta already set are kept, new levels double the quantum of the level above.
+ *
+ * @return 0 on success, -1 if the number of levels is not between 1 and MLFQ_MAX_LEVELS
+ */
+int mlfq_config_set_levels(mlfq_config_t *config, uint32_t levels);
+
+/**
+ * @brief Set the quanta of a configuration from a comma separated list (e.g. "200,400,800")
+ *
+ * Levels without a value in the list double the quantum of the level above.
+ *
+ * @return 0 on success, -1 if the list is not valid
+ */
+int mlfq_config_parse_quanta(mlfq_config_t *config, const char *list);
+
+/**
+ * @brief Initialize empty MLFQ ready queues
+ *
+ * @param mlfq The queues
+ * @param config The configuration, or NULL for the defaults
+ */
+void mlfq_init(mlfq_t *mlfq, const mlfq_config_t *config);
+
+/**
+ * @brief Add a pcb to the queue of its level
+ *
+ * New pcbs start at level 0. A pcb keeps its level and the CPU time used at it between
+ * bursts, unless a priority boost happened since it last entered the queues.
+ */
+int mlfq_enqueue(mlfq_t *mlfq, pcb_t *pcb);
+
+/**
+ * @brief Take a pcb out of the MLFQ queues
+ *
+ * @return The pcb, or NULL if it was not in the queues
+ */
+pcb_t *mlfq_remove(mlfq_t *mlfq, pcb_t *pcb);
+
+/**
+ * @brief Take the first pcb of the highest non-empty level, in O(1)
+ *
+ * @return The pcb, or NULL if all levels are empty
+ */
+pcb_t *mlfq_dequeue(mlfq_t *mlfq);
+
+/**
+ * @brief Number of ticks until the MLFQ has to act on the running pcb
+ *
+ * Either because it exhausts its quantum, because a boost is due or because a pcb of a
+ * higher level is waiting.
+ *
+ * @param mlfq The queues
+ * @param cpu_task The running pcb, not NULL
+ * @param current_time_ms The time of the next tick
+ * @return The number of ticks, at least 1
+ */
+uint32_t mlfq_ticks_to_next_event(const mlfq_t *mlfq, const pcb_t *cpu_task, uint32_t current_time_ms);
+
+/**
+ * @brief Multi-Level Feedback Queue (MLFQ) scheduling algorithm
+ *
+ * - The CPU always runs a pcb of the highest non-empty level, found in O(1) in the bitmap.
+ * - A pcb that uses up the quantum of its level is demoted one level.
+ * - A pcb of a higher level preempts the running one, which goes back to the tail of its level.
+ * - Every boost_interval_ms all pcbs go back to level 0, so that CPU heavy apps are not starved.
+ */
+void mlfq_scheduler(uint32_t current_time_ms, mlfq_t *mlfq, pcb_t **cpu_task);
+
+#endif //MLFQ_H
@@ -18,7 +18,9 @@ static const char PROCESS_REQUEST_STRINGS[][10] = {
     "RUN",
     "BLOCK",
     "ACK",
-    "DONE"
+    "DONE",
+    "HELLO",
+    "PAGE"
 };
 
 // Define the types of requests a process can make to the scheduler
@@ -27,10 +29,11 @@ typedef enum  {
     PROCESS_REQUEST_BLOCK,
     PROCESS_REQUEST_ACK,
     PROCESS_REQUEST_DONE,
+    PROCESS_REQUEST_HELLO,          // Protocol negotiation, time_ms carries the version, nice the MSG_HELLO_* flags
+    PROCESS_REQUEST_PAGE,           // A page of the next RUN, in time_ms
 } process_request_t;
 
-// Define the structure for page information
-// Note: Not used until we get to memory management, but defined here for completeness
+// The pages of the next RUN of an application, collected by the scheduler from its PAGE requests
 typedef struct {
     uint32_t count;            // Number of pages in the burst
     uint32_t ids[MAX_PAGES];      // Array of pages (up to MAX_PAGES)
@@ -42,7 +45,32 @@ typedef struct {
     pid_t pid;                      // Process ID
     process_request_t request;      // Request type
     uint32_t time_ms;               // Time information
+    int32_t nice;                   // Nice value of the burst of a RUN request, 0 otherwise
 } msg_t;
 
+// Protocol
+// The socket carries a stream of msg_t, both sides may write and read several of them at once.
+// - Version 1: the application sends a RUN or BLOCK request and waits for its ACK and its DONE
+//   before sending the next one. Applications that never send a HELLO speak version 1.
+// - Version 2: the application starts with a HELLO carrying its version, answered with a HELLO
+//   carrying the version both sides speak. Requests may then be sent ahead of time: they are
+//   handled in order, each one once the previous one is DONE, so the DONE of a request and the
+//   ACK of the next one are delivered together. A RUN may be preceded by up to MAX_PAGES
+//   PAGE requests, one per page the burst uses (see memory.h). They are not acknowledged.
+// - Version 3: like version 2, but the HELLO carries the descriptors of a shared-memory
+//   channel (see shm.h). Once the HELLO is answered, the messages go through its rings and
+//   the socket only marks the lifetime of the connection.
+// The scheduler collects the messages of a tick for each application and flushes them with
+// a single write.
+#define MSG_PROTOCOL_VERSION 3
+#define MSG_PROTOCOL_PIPELINE_VERSION 2 // First version with the HELLO and the requests sent ahead
+#define MSG_PROTOCOL_SHM_VERSION 3      // First version with the shared-memory channel
+
+// Flags of a HELLO, in its nice field
+#define MSG_HELLO_NO_METRICS 1          // A helper of a tool (loadgen's pacer), left out of the metrics
+
+// Number of messages buffered per connection, in each direction
+#define MSG_BATCH_MAX 16
+
 
 #endif //COMMON_H
@@ -0,0 +1,32 @@
+#ifndef NICE_H
+#define NICE_H
+
+#include <stdint.h>
+
+#define NICE_MIN (-20)
+#define NICE_MAX 19
+#define NICE_0_WEIGHT 1024
+
+// Weight of each nice value, from -20 to 19, as in Linux: every step of nice changes the share
+// of the CPU by about 10%, relative to the other processes.
+static const uint32_t NICE_TO_WEIGHT[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+};
+
+/**
+ * @brief Weight of a nice value, values out of range are clamped to [NICE_MIN, NICE_MAX]
+ */
+static inline uint32_t nice_to_weight(int32_t nice) {
+    if (nice < NICE_MIN) nice = NICE_MIN;
+    if (nice > NICE_MAX) nice = NICE_MAX;
+    return NICE_TO_WEIGHT[nice - NICE_MIN];
+}
+
+#endif //NICE_H
@@ -2,27 +2,72 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <fcntl.h>
+#include <getopt.h>
 #include <unistd.h>
 #include <string.h>
 
 #include "debug.h"
+#include "exporter.h"
 
 #define MAX_CLIENTS 128
+#define MAX_EVENTS 128
 
+#include <poll.h>
+#include <signal.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/epoll.h>
 #include <sys/errno.h>
+#include <sys/timerfd.h>
 
-#include "fifo.h"
-#include "mlfq.h"
-
+#include "metrics.h"
 #include "msg.h"
+#include "profile.h"
 #include "queue.h"
-#include "rr.h"
-#include "sjf.h"
-
-static uint32_t PID = 0;
+#include "scheduler.h"
+#include "shm.h"
+#include "sim.h"
+#include "trace.h"
+
+// The simulation itself lives in a sim_t (sim.h). What is left here is the socket server
+// that stands between it and the applications.
+
+// Pcbs that were DONE while their next request was already sent ahead
+static queue_t pipelined_pcbs = {0};
+
+// Pcbs with messages to flush, linked through flush_next
+static pcb_t *flush_list = NULL;
+
+// Socket traffic, printed on exit
+static uint64_t msgs_received = 0;
+static uint64_t msgs_sent = 0;
+static uint64_t reads = 0;
+static uint64_t writes = 0;
+static uint64_t epoll_waits = 0;
+static uint64_t accepts = 0;
+
+// Published once per tick for the metrics exporter, when there is one
+static exporter_metrics_t live_metrics;
+
+// Cleared by SIGINT/SIGTERM to leave the main loop and print the statistics
+static volatile sig_atomic_t keep_running = 1;
+// Set by SIGUSR1 to print the profile of the hot path at the next chance
+static volatile sig_atomic_t dump_requested = 0;
+
+// Real time clock: the tick at simulated time t is due at tick_origin_ns + t, whatever the
+// time the previous ticks took, so the simulated time never drifts from the wall clock.
+#define TICK_NS ((uint64_t) TICKS_MS * 1000000)
+static uint64_t tick_origin_ns = 0;
+static int timer_fd = -1;               // timerfd armed at the next deadline, in the epoll set
+static int timer_expired = 0;           // Set by check_new_commands() when the timer fired
+static uint64_t tick_overruns = 0;      // Ticks that started a whole tick or more after their deadline
+static uint64_t idle_ticks = 0;         // Ticks skipped while the cores were idle (tickless idle)
 
 
+/**
+ * @brief Send the messages queued for the applications, one write per application
+ */
+static void flush_messages(void);
 
 /**
  * @brief Set up the server socket for the scheduler.
@@ -75,28 +120,48 @@ int setup_server_socket(const char *socket_path) {
 }
 
 /**
- * @brief Check for new client connections and add them to the queue.
+ * @brief Set up the epoll instance used as the event loop of the scheduler.
  *
- * This function accepts new client connections on the server socket,
- * sets the client sockets to non-blocking mode, and enqueues them
- * into the provided queue.
+ * The server socket is registered edge-triggered with a NULL data pointer,
+ * so that it can be told apart from the client sockets, which carry their pcb.
  *
- * @param command_queue The queue to which new pcb will be added
  * @param server_fd The server socket file descriptor
+ * @return int Returns the epoll file descriptor on success, or -1 on failure
  */
-typedef enum  {
-    NULL_SCHEDULER = -1,
-    SCHED_FIFO = 0,
-    SCHED_SJF,
-    SCHED_RR,
-    SCHED_MLFQ
-} scheduler_en;
-
-void check_new_commands(queue_t *command_queue, queue_t *blocked_queue, queue_t *ready_queue, queue_t mlfq_rq[],scheduler_en scheduler_type, int server_fd, uint32_t current_time_ms) {
-    // Accept new client connections
+int setup_epoll(int server_fd) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    struct epoll_event ev = {
+        .events = EPOLLIN | EPOLLET,
+        .data.ptr = NULL
+    };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) < 0) {
+        perror("epoll_ctl: server socket");
+        close(epoll_fd);
+        return -1;
+    }
+    return epoll_fd;
+}
+
+/**
+ * @brief Accept all pending client connections.
+ *
+ * This function accepts new client connections on the server socket until
+ * it would block, sets the client sockets to non-blocking mode, creates a pcb
+ * for each of them and registers them (edge-triggered) in the epoll instance.
+ *
+ * @param sim The simulation, the current time is the arrival time of the new clients
+ * @param epoll_fd The epoll file descriptor
+ * @param server_fd The server socket file descriptor
+ */
+static void accept_new_clients(sim_t *sim, int epoll_fd, int server_fd) {
     int client_fd;
     do {
         client_fd = accept(server_fd, NULL, NULL);
+        accepts++;
         if (client_fd < 0) {
             if (errno == EMFILE || errno == ENFILE) {
                 perror("accept: too many fds");
@@ -122,232 +187,816 @@ void check_new_commands(queue_t *command_queue, queue_t *blocked_queue, queue_t
             fcntl(client_fd, F_SETFD, fdflags | FD_CLOEXEC);
         }
         DBG("[Scheduler] New client connected: fd=%d\n", client_fd);
-        // New PCBs do not have a time yet, will be set when we receive a RUN message
-        pcb_t *pcb = new_pcb(++PID, client_fd, 0);
-        enqueue_pcb(command_queue, pcb);
-    } while (client_fd > 0);
-
-    // Check queue for new commands in the command queue
-    queue_elem_t * elem = command_queue->head;
-    while (elem != NULL) {
-        pcb_t *current_pcb = elem->pcb;
-        msg_t msg;
-        int n = read(current_pcb->sockfd, &msg, sizeof(msg_t));
-        if (n <= 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // No data available right now, move to next
-                elem = elem->next;
-            } else {
-                if (n < 0) {
-                    perror("read");
-                } else {
-                    DBG("Connection closed by remote host\n");
+        pcb_t *pcb = sim_arrive(sim, client_fd);
+        if (!pcb) {
+            perror("new_pcb");
+            close(client_fd);
+            continue;
+        }
+        // The pcb travels with the event, so we never have to look it up
+        struct epoll_event ev = {
+            .events = EPOLLIN | EPOLLRDHUP | EPOLLET,
+            .data.ptr = pcb
+        };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+            perror("epoll_ctl: client socket");
+            close(client_fd);
+            sim_leave(sim, pcb);
+            continue;
+        }
+    } while (client_fd >= 0);
+}
+
+/**
+ * @brief Queue a message for the application of a pcb, it is sent by flush_messages()
+ */
+static void queue_message(pcb_t *pcb, process_request_t request, uint32_t time_ms) {
+    if (pcb->outbox_count == MSG_BATCH_MAX) {
+        flush_messages();
+    }
+    if (pcb->outbox_count == 0) {
+        pcb->flush_next = flush_list;
+        flush_list = pcb;
+    }
+    pcb->outbox[pcb->outbox_count++] = (msg_t) {
+        .pid = pcb->pid,
+        .request = request,
+        .time_ms = time_ms
+    };
+}
+
+static void flush_messages(void) {
+    if (!flush_list) return;
+    PROFILE_BEGIN(PROFILE_FLUSH);
+    while (flush_list) {
+        pcb_t *pcb = flush_list;
+        flush_list = pcb->flush_next;
+        pcb->flush_next = NULL;
+        size_t size = pcb->outbox_count * sizeof(msg_t);
+        pcb->outbox_count = 0;
+        if (pcb->channel) {
+            int wake;
+            uint32_t count = (uint32_t) (size / sizeof(msg_t));
+            uint32_t pushed = shm_ring_push(&pcb->channel->replies, pcb->outbox, count, &wake);
+            if (pushed < count) {
+                printf("Reply ring of process %d is full, %u messages dropped\n", pcb->pid, count - pushed);
+            }
+            msgs_sent += pushed;
+            if (wake) {
+                uint64_t one = 1;
+                if (write(pcb->reply_efd, &one, sizeof(one)) != sizeof(one)) {
+                    perror("write: eventfd");
                 }
-                // Remove from queue
-                queue_elem_t *tmp = elem;
-                elem = elem->next;
-                free(current_pcb);
-                free(tmp);
+                writes++;
             }
             continue;
         }
-        // We have received a message
-        if (msg.request == PROCESS_REQUEST_RUN) {
-            current_pcb->pid = msg.pid; // Set the pid from the message
-            current_pcb->time_ms = msg.time_ms;
-            current_pcb->ellapsed_time_ms = 0;
-            current_pcb->status = TASK_RUNNING;
-            if (scheduler_type == SCHED_MLFQ) {
-                enqueue_pcb(&mlfq_rq[0], current_pcb); // nível 0 da MLFQ
+        ssize_t n;
+        do {
+            n = write(pcb->sockfd, pcb->outbox, size);
+        } while (n < 0 && errno == EINTR);
+        if (n != (ssize_t) size) {
+            perror("write");
+            continue;
+        }
+        msgs_sent += size / sizeof(msg_t);
+        writes++;
+    }
+    PROFILE_END(PROFILE_FLUSH);
+}
+
+static void close_passed_fds(pcb_t *pcb) {
+    for (uint32_t i = 0; i < pcb->n_passed_fds; i++) {
+        close(pcb->passed_fds[i]);
+    }
+    pcb->n_passed_fds = 0;
+}
+
+/**
+ * @brief Release the pcb of a client that closed its connection.
+ *
+ * Well-behaved applications only disconnect after their last DONE, while waiting
+ * for new commands. If the connection drops while the pcb is still scheduled,
+ * it is first taken out of the core or queue that holds it.
+ */
+static void release_client(sim_t *sim, pcb_t *pcb) {
+    // Its last messages may still be waiting to be sent
+    flush_messages();
+    if (pcb->queue == &pipelined_pcbs) {
+        remove_pcb(&pipelined_pcbs, pcb);
+    }
+    // Closing the socket (and the eventfd) also removes it from the epoll instance
+    close(pcb->sockfd);
+    if (pcb->channel) {
+        shm_channel_unmap(pcb->channel);
+        close(pcb->request_efd);
+        close(pcb->reply_efd);
+    }
+    close_passed_fds(pcb);
+    sim_leave(sim, pcb);
+}
+
+/**
+ * @brief Handle a RUN or BLOCK request of a pcb waiting for instructions and acknowledge it,
+ * or collect a page of its next RUN.
+ */
+static void handle_request(sim_t *sim, pcb_t *pcb, const msg_t *msg) {
+    if (msg->request == PROCESS_REQUEST_PAGE) {
+        // Not a command: the pcb keeps waiting for its RUN
+        if (pcb->next_pages.count < MAX_PAGES) {
+            pcb->next_pages.ids[pcb->next_pages.count++] = msg->time_ms;
+        } else {
+            printf("Process %d sent more than %d pages for a burst\n", pcb->pid, MAX_PAGES);
+        }
+    } else if (msg->request == PROCESS_REQUEST_RUN) {
+        pcb->pid = msg->pid; // Set the pid from the message
+        // The pages are touched at the first dispatch, before the next PAGE can be handled (after the DONE)
+        sim_request_run(sim, pcb, msg->time_ms, msg->nice, pcb->next_pages.ids, pcb->next_pages.count);
+        pcb->next_pages.count = 0;
+    } else if (msg->request == PROCESS_REQUEST_BLOCK) {
+        pcb->pid = msg->pid; // Set the pid from the message
+        sim_request_block(sim, pcb, msg->time_ms);
+    } else {
+        printf("Unexpected message received from client\n");
+    }
+}
+
+/**
+ * @brief Read from the socket of a client, keeping the descriptors passed along (SCM_RIGHTS)
+ */
+static ssize_t receive_from_socket(pcb_t *pcb, void *buf, size_t size) {
+    union {
+        char buf[CMSG_SPACE(SHM_FD_COUNT * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {.iov_base = buf, .iov_len = size};
+    struct msghdr header = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf)
+    };
+    ssize_t n = recvmsg(pcb->sockfd, &header, MSG_CMSG_CLOEXEC);
+    if (n <= 0) return n;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&header); c != NULL; c = CMSG_NXTHDR(&header, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        size_t n_fds = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < n_fds; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+            if (pcb->n_passed_fds < SHM_FD_COUNT) {
+                pcb->passed_fds[pcb->n_passed_fds++] = fd;
             } else {
-                enqueue_pcb(ready_queue, current_pcb); // para FIFO, RR ou SJF
+                close(fd);
             }
+        }
+    }
+    return n;
+}
 
-            DBG("Process %d requested RUN for %d ms\n", current_pcb->pid, current_pcb->time_ms);
-        } else if (msg.request == PROCESS_REQUEST_BLOCK) {
-            current_pcb->pid = msg.pid; // Set the pid from the message
-            current_pcb->time_ms = msg.time_ms;
-            current_pcb->status = TASK_BLOCKED;
-            enqueue_pcb(blocked_queue, current_pcb);
-            DBG("Process %d requested BLOCK for %d ms\n", current_pcb->pid);
-        } else {
-            printf("Unexpected message received from client\n");
+/**
+ * @brief Map the channel passed with the HELLO and watch its request eventfd
+ *
+ * From then on the socket is only watched for the end of the connection. The eventfd is
+ * edge-triggered and never read: every signal raises a new edge, and the ring tells what
+ * is pending.
+ *
+ * @return The channel, or NULL if the descriptors are not a valid channel
+ */
+static shm_channel_t *attach_channel(pcb_t *pcb, int epoll_fd) {
+    if (pcb->n_passed_fds != SHM_FD_COUNT) return NULL;
+    shm_channel_t *channel = shm_channel_map(pcb->passed_fds[SHM_FD_MEMORY]);
+    if (!channel) return NULL;
+    struct epoll_event ev = {
+        .events = EPOLLIN | EPOLLET,
+        .data.ptr = pcb
+    };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pcb->passed_fds[SHM_FD_REQUESTS], &ev) < 0) {
+        perror("epoll_ctl: request eventfd");
+        shm_channel_unmap(channel);
+        return NULL;
+    }
+    ev.events = EPOLLRDHUP | EPOLLET;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, pcb->sockfd, &ev) < 0) {
+        perror("epoll_ctl: client socket");
+    }
+    pcb->request_efd = pcb->passed_fds[SHM_FD_REQUESTS];
+    pcb->reply_efd = pcb->passed_fds[SHM_FD_REPLIES];
+    close(pcb->passed_fds[SHM_FD_MEMORY]);  // The mapping keeps the memory
+    pcb->n_passed_fds = 0;
+    return channel;
+}
+
+/**
+ * @brief Answer a HELLO with the protocol version both sides speak
+ *
+ * Version 3 moves the application to the shared-memory channel sent with the HELLO,
+ * or falls back to version 2 if there is none. The answer still goes through the socket,
+ * the application waits for it before using the rings.
+ */
+static void handle_hello(pcb_t *pcb, uint32_t version, int32_t flags, int epoll_fd) {
+    if (flags & MSG_HELLO_NO_METRICS) pcb->metered = 0;
+    if (version > MSG_PROTOCOL_VERSION) version = MSG_PROTOCOL_VERSION;
+    shm_channel_t *channel = NULL;
+    if (version >= MSG_PROTOCOL_SHM_VERSION && (channel = attach_channel(pcb, epoll_fd)) == NULL) {
+        version = MSG_PROTOCOL_PIPELINE_VERSION;
+    }
+    close_passed_fds(pcb);
+    pcb->protocol = version;
+    queue_message(pcb, PROCESS_REQUEST_HELLO, version);
+    if (channel) {
+        flush_messages();
+        pcb->channel = channel;
+    }
+    DBG("Process %d speaks protocol version %u\n", pcb->pid, version);
+}
+
+/**
+ * @brief Read and handle the pending messages of a client.
+ *
+ * Client sockets are registered edge-triggered, so the socket is read until it is
+ * empty, as many messages at a time as fit in the inbox of the pcb. Only pcbs waiting
+ * for instructions (TASK_COMMAND) may have a RUN or BLOCK request handled; the request
+ * is handled and acknowledged immediately. Requests sent ahead by applications that sent a
+ * HELLO stay in the inbox (and the socket, once the inbox is full)
+ * until the pcb is DONE with the current one. Applications using the shared-memory
+ * transport are read from their request ring instead, and the socket is only read to
+ * see the end of the connection.
+ *
+ * @return 0 if the client is still connected, -1 if it was released
+ */
+static int handle_client_messages(sim_t *sim, pcb_t *pcb, int epoll_fd) {
+    while (1) {
+        // Handle the complete messages, in order
+        uint32_t count = pcb->inbox_bytes / sizeof(msg_t);
+        uint32_t used = 0;
+        for (; used < count; used++) {
+            const msg_t *msg = &pcb->inbox[used];
+            if (msg->request == PROCESS_REQUEST_HELLO) {
+                handle_hello(pcb, msg->time_ms, msg->nice, epoll_fd);
+                continue;
+            }
+            if (pcb->status != TASK_COMMAND) {
+                if (pcb->protocol >= 2) break;  // Sent ahead, handled once the pcb is DONE
+                printf("Unexpected message received from process %d while it is not waiting for commands\n", pcb->pid);
+                continue;
+            }
+            handle_request(sim, pcb, msg);
+        }
+        if (used > 0) {
+            pcb->inbox_bytes -= used * sizeof(msg_t);
+            memmove(pcb->inbox, &pcb->inbox[used], pcb->inbox_bytes);
+        }
+
+        size_t space = sizeof(pcb->inbox) - pcb->inbox_bytes;
+        if (space == 0) {
+            return 0;
+        }
+        if (pcb->channel) {
+            uint32_t popped = shm_ring_pop(&pcb->channel->requests, &pcb->inbox[pcb->inbox_bytes / sizeof(msg_t)],
+                                           (uint32_t) (space / sizeof(msg_t)));
+            if (popped > 0) {
+                msgs_received += popped;
+                pcb->inbox_bytes += popped * sizeof(msg_t);
+                continue;
+            }
+        }
+        if (pcb->socket_drained) {
+            return 0;
+        }
+        msg_t discarded[MSG_BATCH_MAX];
+        ssize_t n = pcb->channel ? receive_from_socket(pcb, discarded, sizeof(discarded)) :
+                                   receive_from_socket(pcb, (char *) pcb->inbox + pcb->inbox_bytes, space);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pcb->socket_drained = 1;   // Wait for the next edge
+                return 0;
+            }
+            perror("read");
+            release_client(sim, pcb);
+            return -1;
+        }
+        if (n == 0) {
+            if (pcb->inbox_bytes > 0) {
+                printf("Truncated message received from client\n");
+            }
+            DBG("Connection closed by remote host\n");
+            release_client(sim, pcb);
+            return -1;
+        }
+        reads++;
+        if (pcb->channel) {
+            printf("Unexpected data on the socket of process %d, it uses the shared-memory transport\n", pcb->pid);
             continue;
         }
-        // Remove from command queue
-        remove_queue_elem(command_queue, elem);
-        queue_elem_t *tmp = elem;
-        elem = elem->next;
-        free(tmp);
-
-        // Send ack message
-        msg_t ack_msg = {
-            .pid = current_pcb->pid,
-            .request = PROCESS_REQUEST_ACK,
-            .time_ms = current_time_ms
-        };
-        if (write(current_pcb->sockfd, &ack_msg, sizeof(msg_t)) != sizeof(msg_t)) {
-            perror("write");
+        msgs_received += ((pcb->inbox_bytes + n) / sizeof(msg_t)) - (pcb->inbox_bytes / sizeof(msg_t));
+        pcb->inbox_bytes += n;
+        // A short read emptied the socket, whatever comes next raises a new edge
+        if ((size_t) n < space) {
+            pcb->socket_drained = 1;
         }
-        DBG("Send ACK message to process %d with time %d\n", current_pcb->pid, current_time_ms);
     }
+}
 
+/**
+ * @brief Notifier of the simulation: queues the message for the application.
+ *
+ * A DONE makes the application come back with a new command. It may already have sent it ahead, then its pcb is queued to
+ * have it handled by the next check_new_commands(), where the reply would have been read.
+ */
+static void ossim_notifier(void *context, pcb_t *pcb, process_request_t request, uint32_t current_time_ms) {
+    queue_message(pcb, request, current_time_ms);
+    if (request == PROCESS_REQUEST_DONE) {
+        if (pcb->protocol >= 2 && (pcb->inbox_bytes >= sizeof(msg_t) || !pcb->socket_drained ||
+                                   (pcb->channel && shm_ring_length(&pcb->channel->requests) > 0))) {
+            enqueue_pcb(&pipelined_pcbs, pcb);
+        }
+    }
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
 /**
- * @brief Check the blocked queue for messages from clients.
+ * @brief Wait for socket events and handle new connections and commands.
  *
- * This function iterates through the blocked queue, checking each client
- * socket for incoming messages. If a RUN message is received, the corresponding
- * pcb is moved to the command queue and an ACK message is sent back to the client.
- * If a client disconnects or an error occurs, the client is removed from the blocked queue.
+ * Only the sockets reported by epoll are touched, so silent clients cost nothing.
+ * New connections are accepted and registered, and the RUN/BLOCK requests of clients
+ * waiting for instructions are moved to the ready or blocked queue and acknowledged.
+ * Requests that were sent ahead of a DONE are handled first. The messages of the
+ * applications, including the DONEs of the last tick, are flushed before waiting for
+ * events and before returning, so a DONE and the ACK of the request sent ahead of it
+ * share a single write.
  *
- * @param blocked_queue The queue containing PCBs in I/O wait stated (blocked) from CPU
- * @param command_queue The queue where PCBs ready for new instructions will be moved
- * @param current_time_ms The current time in milliseconds
+ * @param sim The simulation, whose ready and blocked queues receive the PCBs
+ * @param epoll_fd The epoll file descriptor
+ * @param server_fd The server socket file descriptor
+ * @param timeout_ms How long to keep handling events before returning (0 to only handle pending ones,
+ *                   negative to block until at least one event was handled)
  */
-void check_blocked_queue(queue_t * blocked_queue, queue_t * command_queue, uint32_t current_time_ms) {
-    // Check all elements of the blocked queue for new messages
-    queue_elem_t * elem = blocked_queue->head;
-    while (elem != NULL) {
-        pcb_t *pcb = elem->pcb;
-
-        // Make sure the time is updated only once per cycle
-        if (pcb->last_update_time_ms < current_time_ms) {
-            if (pcb->time_ms > TICKS_MS) {
-                pcb->time_ms -= TICKS_MS;
-            } else {
-                pcb->time_ms = 0;
+void check_new_commands(sim_t *sim, int epoll_fd, int server_fd, int timeout_ms) {
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t deadline_ms = monotonic_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+    int handled = 0;
+    pcb_t *pcb;
+    if (pipelined_pcbs.length > 0) {
+        PROFILE_BEGIN(PROFILE_COMMANDS);
+        while ((pcb = dequeue_pcb(&pipelined_pcbs)) != NULL) {
+            handle_client_messages(sim, pcb, epoll_fd);
+            handled++;
+        }
+        PROFILE_END(PROFILE_COMMANDS);
+    }
+    int wait_ms = (timeout_ms < 0 && handled > 0) ? 0 : timeout_ms;
+    while (1) {
+        flush_messages();
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, wait_ms);
+        epoll_waits++;
+        if (n < 0) {
+            // Interrupted by a signal: let the main loop have a look at it
+            if (errno != EINTR) {
+                perror("epoll_wait");
             }
+            return;
         }
-
-        if (pcb->time_ms == 0) {
-            // Send DONE message to the application
-            msg_t msg = {
-                .pid = pcb->pid,
-                .request = PROCESS_REQUEST_DONE,
-                .time_ms = current_time_ms
-            };
-            if (write(pcb->sockfd, &msg, sizeof(msg_t)) != sizeof(msg_t)) {
-                perror("write");
+        // Only the handling of the events is timed, not the wait for them
+        PROFILE_BEGIN(PROFILE_COMMANDS);
+        for (int i = 0; i < n; i++) {
+            pcb = events[i].data.ptr;
+            if (events[i].events == 0) {
+                continue;   // Its pcb was released
+            }
+            if (events[i].data.ptr == &timer_fd) {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+                    perror("read: timerfd");
+                }
+                timer_expired = 1;
+            } else if (pcb == NULL) {
+                accept_new_clients(sim, epoll_fd, server_fd);
+            } else {
+                // With the shared-memory transport, a plain EPOLLIN comes from the request eventfd
+                if (!pcb->channel || (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                    pcb->socket_drained = 0;
+                }
+                if (handle_client_messages(sim, pcb, epoll_fd) < 0) {
+                    // The socket and the eventfd of a pcb may both be in this batch
+                    for (int j = i + 1; j < n; j++) {
+                        if (events[j].data.ptr == pcb) events[j].events = 0;
+                    }
+                }
             }
-            DBG("Process %d finished BLOCK, sending DONE\n", pcb->pid);
-            pcb->status = TASK_COMMAND;
-            pcb->last_update_time_ms = current_time_ms;
-            enqueue_pcb(command_queue, pcb);
-
-            // Remove from blocked queue
-            remove_queue_elem(blocked_queue, elem);
-            queue_elem_t *tmp = elem;
-            elem = elem->next;  // Do this here, because we free it in the next line
-            free(tmp);
-        } else {
-            elem = elem->next;  // If not done already, do it now
         }
+        if (n > 0) PROFILE_END(PROFILE_COMMANDS);
+        handled += n;
+        if (timeout_ms < 0) {
+            // Block until something happened, then only drain what is still pending
+            if (handled > 0 && n < MAX_EVENTS) break;
+            wait_ms = (handled > 0) ? 0 : -1;
+            continue;
+        }
+        uint64_t now_ms = monotonic_ms();
+        wait_ms = (now_ms < deadline_ms) ? (int) (deadline_ms - now_ms) : 0;
+        // Keep going while there is time left or the event buffer was full
+        if (wait_ms == 0 && n < MAX_EVENTS) break;
     }
+    flush_messages();
 }
 
-static const char *SCHEDULER_NAMES[] = {
-    "FIFO",
-    "SJF",
-    "RR",
-    "MLFQ",
-    NULL
-};
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
 
+/**
+ * @brief Wall clock time at which the tick of a simulated time is due
+ */
+static uint64_t tick_due_ns(uint32_t time_ms) {
+    return tick_origin_ns + (uint64_t) time_ms * 1000000;
+}
 
+/**
+ * @brief Create the tick timer and add it to the epoll instance
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int setup_tick_timer(int epoll_fd) {
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+    struct epoll_event ev = {
+        .events = EPOLLIN,
+        .data.ptr = &timer_fd
+    };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0) {
+        perror("epoll_ctl: timerfd");
+        close(timer_fd);
+        return -1;
+    }
+    return 0;
+}
 
-scheduler_en get_scheduler(const char *name) {
-    for (int i = 0; SCHEDULER_NAMES[i] != NULL; i++) {
-        if (strcmp(name, SCHEDULER_NAMES[i]) == 0) {
-            return (scheduler_en)i;
-        }
+/**
+ * @brief Arm the tick timer at an absolute deadline, 0 to disarm it
+ */
+static void arm_tick_timer(uint64_t deadline_ns) {
+    struct itimerspec spec = {
+        .it_value = {.tv_sec = (time_t) (deadline_ns / 1000000000), .tv_nsec = (long) (deadline_ns % 1000000000)}
+    };
+    timer_expired = 0;
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        perror("timerfd_settime");
     }
-    printf("Scheduler %s not recognized. Available options are:\n", name);
-    for (int i = 0; SCHEDULER_NAMES[i] != NULL; i++) {
-        printf(" - %s\n", SCHEDULER_NAMES[i]);
+}
+
+/**
+ * @brief Handle the socket events until the tick of the current time is due
+ *
+ * @return How many whole ticks the tick starts after its deadline, 0 if it is on time
+ */
+static uint64_t wait_for_tick(sim_t *sim, int epoll_fd, int server_fd) {
+    uint64_t due_ns = tick_due_ns(sim->current_time_ms);
+    if (monotonic_ns() < due_ns) {
+        arm_tick_timer(due_ns);
+        while (!timer_expired && keep_running && monotonic_ns() < due_ns) {
+            check_new_commands(sim, epoll_fd, server_fd, -1);
+        }
     }
-    return NULL_SCHEDULER;
+    uint64_t now_ns = monotonic_ns();
+    return (now_ns > due_ns) ? (now_ns - due_ns) / TICK_NS : 0;
 }
 
-int main(int argc, char *argv[]) {
+/**
+ * @brief Whether no core has anything to run and no application waits to be handled
+ */
+static int machine_idle(const sim_t *sim) {
+    const machine_t *machine = &sim->machine;
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        if (machine->cores[i].task || machine->scheduler->length(machine->cores[i].rq) > 0) return 0;
+    }
+    return pipelined_pcbs.length == 0;
+}
 
-    #define MLFQ_LEVELS 3
-    queue_t mlfq_rq[MLFQ_LEVELS];
-    int current_level = 0;
+/**
+ * @brief Tickless idle: sleep until a socket event or the next block expiry, without ticking
+ *
+ * With idle cores, a tick only moves the clock until a block ends or an application sends
+ * something. Once woken up, the ticks that went by are skipped in one go, up to the one the
+ * next block expiry needs, and the clock is back on the deadline of the tick now due.
+ */
+static void wait_idle(sim_t *sim, int epoll_fd) {
+    // The DONEs of the last tick must reach the applications before sleeping
+    flush_messages();
+    uint32_t ticks = ticks_to_next_event(sim);
+    arm_tick_timer(ticks > 0 ? tick_due_ns(sim->current_time_ms + (ticks - 1) * TICKS_MS) : 0);
+    // Poll the epoll instance itself, so its events are left for check_new_commands()
+    struct pollfd pfd = {.fd = epoll_fd, .events = POLLIN};
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+        perror("poll");
+    }
+    uint64_t now_ns = monotonic_ns();
+    uint64_t due_ns = tick_due_ns(sim->current_time_ms);
+    if (now_ns < due_ns) return;
+    uint64_t skipped = (now_ns - due_ns) / TICK_NS;
+    if (ticks > 0 && skipped > ticks - 1) skipped = ticks - 1;
+    if (skipped > 0) {
+        fast_forward(sim, (uint32_t) skipped);
+        idle_ticks += skipped;
+    }
+}
 
-    // Inicializa todas as filas MLFQ
-    for (int i = 0; i < MLFQ_LEVELS; i++) {
-        mlfq_rq[i].head = NULL;
-        mlfq_rq[i].tail = NULL;
+/**
+ * @brief Publish the state of the simulation for the metrics exporter, once per tick
+ *
+ * @param schedule_ns The time run_machine() took in this tick
+ */
+static void publish_metrics(const sim_t *sim, uint64_t schedule_ns) {
+    exporter_metrics_t *m = &live_metrics;
+    const machine_t *machine = &sim->machine;
+    uint64_t running = 0, ready = 0, dispatches = 0, preemptions = 0, steals = 0;
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        const cpu_core_t *core = &machine->cores[i];
+        running += (core->task != NULL);
+        ready += machine->scheduler->length(core->rq);
+        dispatches += core->dispatches;
+        preemptions += core->preemptions;
+        steals += core->steals;
     }
-    if (argc != 2) {
-        printf("Usage: %s <scheduler>\nScheduler options: FIFO", argv[0]);
-        exit(EXIT_FAILURE);
+    exporter_set(&m->time_ms, sim->current_time_ms);
+    exporter_set(&m->tick_overruns, tick_overruns);
+    exporter_set(&m->idle_ticks, idle_ticks);
+    exporter_set(&m->clients, sim->pcb_pool.in_use);
+    exporter_set(&m->running, running);
+    exporter_set(&m->ready, ready);
+    exporter_set(&m->blocked, sim->blocked_queue.heap.size);
+    exporter_set(&m->awaiting_commands, sim->awaiting_commands);
+    exporter_set(&m->dispatches, dispatches);
+    exporter_set(&m->preemptions, preemptions);
+    exporter_set(&m->steals, steals);
+    // Only the tick loop writes, so reading back its own values needs no ordering
+    exporter_set(&m->schedule_ns, atomic_load_explicit(&m->schedule_ns, memory_order_relaxed) + schedule_ns);
+    exporter_set(&m->schedule_calls, atomic_load_explicit(&m->schedule_calls, memory_order_relaxed) + 1);
+    if (schedule_ns > atomic_load_explicit(&m->schedule_max_ns, memory_order_relaxed)) {
+        exporter_set(&m->schedule_max_ns, schedule_ns);
     }
+    exporter_set(&m->msgs_received, msgs_received);
+    exporter_set(&m->msgs_sent, msgs_sent);
+    exporter_set(&m->reads, reads);
+    exporter_set(&m->writes, writes);
+    exporter_set(&m->epoll_waits, epoll_waits);
+    exporter_set(&m->accepts, accepts);
+}
+
+static void stop_handler(int signum) {
+    (void) signum;
+    keep_running = 0;
+}
+
+#if PROFILE_ENABLED
+static void dump_handler(int signum) {
+    (void) signum;
+    dump_requested = 1;
+}
+#endif
+
+/**
+ * @brief Print the profile requested by SIGUSR1, from the main loop since stdio is not async-signal-safe
+ */
+static void check_profile_dump(uint32_t current_time_ms) {
+    if (!dump_requested) return;
+    dump_requested = 0;
+    printf("Profile at time %u ms\n", current_time_ms);
+    PROFILE_DUMP(stdout);
+}
+
+int main(int argc, char *argv[]) {
 
     // Parse arguments
-    scheduler_en scheduler_type = get_scheduler(argv[1]);
-    if (scheduler_type == NULL_SCHEDULER) {
+    int virtual_time = 0;
+    int tickless = 0;
+    uint32_t expected_clients = 0;
+    uint32_t max_clients = MAX_CLIENTS;
+    uint32_t n_cpus = 1;
+    const char *trace_path = NULL;
+    const char *metrics_path = NULL;
+    uint64_t trace_capacity = TRACE_DEFAULT_CAPACITY;
+    scheduler_config_t config;
+    scheduler_config_default(&config);
+    memory_config_t memory;
+    memory_config_default(&memory);
+    static const struct option long_options[] = {
+        {"cpus", required_argument, NULL, 'p'},
+        {"virtual-time", no_argument, NULL, 'v'},
+        {"tickless", no_argument, NULL, 'i'},
+        {"clients", required_argument, NULL, 'c'},
+        {"max-clients", required_argument, NULL, 'm'},
+        {"trace", required_argument, NULL, 't'},
+        {"trace-size", required_argument, NULL, 'T'},
+        {"metrics", required_argument, NULL, 'M'},
+        SCHEDULER_CONFIG_LONG_OPTIONS,
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:vic:m:t:T:M:" SCHEDULER_CONFIG_SHORT_OPTIONS, long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'p':
+                n_cpus = (uint32_t) strtoul(optarg, NULL, 10);
+                if (n_cpus == 0) {
+                    fprintf(stderr, "The number of cpus must be at least 1\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't':
+                trace_path = optarg;
+                break;
+            case 'T':
+                trace_capacity = strtoull(optarg, NULL, 10);
+                break;
+            case 'M':
+                metrics_path = optarg;
+                break;
+            case 'm':
+                max_clients = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                virtual_time = 1;
+                break;
+            case 'i':
+                tickless = 1;
+                break;
+            case 'c':
+                expected_clients = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            default:
+                if (scheduler_config_parse_option(&config, &memory, opt, optarg) <= 0) exit(EXIT_FAILURE);
+                break;
+        }
+    }
+    if (argc - optind != 1) {
+        printf("Usage: %s [--cpus N] [--max-clients N] [--virtual-time [--clients N] | --tickless]\n"
+               SCHEDULER_CONFIG_USAGE
+               "          [--trace FILE [--trace-size RECORDS]] [--metrics SOCKET] <scheduler>\n"
+               "Scheduler options:", argv[0]);
+        for (int i = 0; SCHEDULERS[i] != NULL; i++) {
+            printf(" %s", SCHEDULERS[i]->name);
+        }
+        printf("\n");
+        exit(EXIT_FAILURE);
+    }
+    const scheduler_t *scheduler = get_scheduler(argv[optind]);
+    if (!scheduler) {
         return EXIT_FAILURE;
     }
 
-    // We set up 3 queues: 1 for the simulator and 2 for scheduling
-    // - COMMAND queue: for PCBs that are waiting for (new) instructions from the app
-    // - READY queue: for PCBs that are ready to run on the CPU
+    // We set up 2 queues for scheduling:
+    // - READY queues: one per core, for PCBs that are ready to run on that core
     // - BLOCKED queue: for PCBs that are blocked waiting for I/O
-    queue_t command_queue = {.head = NULL, .tail = NULL};
-    queue_t ready_queue = {.head = NULL, .tail = NULL};
-    queue_t blocked_queue = {.head = NULL, .tail = NULL};
+    // PCBs waiting for (new) instructions from the app are not kept in a queue,
+    // they are reached through their socket registration in the epoll instance.
+    // The queues are linked through the pcbs, which are taken from a pool.
+    // Each core has its own READY queue and a pointer to the PCB running on it.
+    sim_t sim;
+    if (sim_init(&sim, scheduler, n_cpus, max_clients, &config, &memory, ossim_notifier, NULL) < 0) {
+        fprintf(stderr, "Failed to allocate the simulation of %u cpus for %u clients\n", n_cpus, max_clients);
+        return EXIT_FAILURE;
+    }
 
-    // We only have a single CPU that is a pointer to the actively running PCB on the CPU
-    pcb_t *CPU = NULL;
+    // Writing to an application that went away must not kill the simulator
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction sa = {.sa_handler = stop_handler};
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+#if PROFILE_ENABLED
+    struct sigaction usr1 = {.sa_handler = dump_handler};
+    sigaction(SIGUSR1, &usr1, NULL);
+#endif
+    if (trace_path && trace_open(trace_path, trace_capacity) < 0) {
+        perror(trace_path);
+        return EXIT_FAILURE;
+    }
 
     int server_fd = setup_server_socket(SOCKET_PATH);
     if (server_fd < 0) {
         fprintf(stderr, "Failed to set up server socket\n");
         return 1;
     }
-    printf("Scheduler server listening on %s...\n", SOCKET_PATH);
-    uint32_t current_time_ms = 0;
-    while (1) {
-        // Check for new connections and/or instructions
-        check_new_commands(&command_queue, &blocked_queue, &ready_queue,mlfq_rq, scheduler_type, server_fd, current_time_ms);
-
-        if (current_time_ms%1000 == 0) {
-            printf("Current time: %d s\n", current_time_ms/1000);
+    int epoll_fd = setup_epoll(server_fd);
+    if (epoll_fd < 0) {
+        fprintf(stderr, "Failed to set up epoll\n");
+        return 1;
+    }
+    if (!virtual_time && setup_tick_timer(epoll_fd) < 0) {
+        fprintf(stderr, "Failed to set up the tick timer\n");
+        return 1;
+    }
+    exporter_t *exporter = NULL;
+    if (metrics_path) {
+        exporter = exporter_start(metrics_path, &live_metrics, scheduler->name);
+        if (!exporter) return EXIT_FAILURE;
+        printf("Metrics served on %s\n", metrics_path);
+    }
+    printf("Scheduler server listening on %s%s...\n", SOCKET_PATH, virtual_time ? " (virtual time)" : "");
+    uint32_t reported_time_s = UINT32_MAX;
+    uint64_t reported_overruns = 0;
+    tick_origin_ns = monotonic_ns();
+    while (keep_running) {
+        uint64_t late_ticks = 0;
+        check_profile_dump(sim.current_time_ms);
+        if (virtual_time) {
+            // Time may only move on once every application has told us what it wants next.
+            // With nothing scheduled at all, or while fewer than the expected number of
+            // applications have connected, we simply wait for the next connection.
+            while (sim.awaiting_commands > 0 || (uint32_t) sim.last_pid < expected_clients ||
+                   ticks_to_next_event(&sim) == 0) {
+                if (!keep_running) break;
+                check_profile_dump(sim.current_time_ms);
+                check_new_commands(&sim, epoll_fd, server_fd, -1);
+            }
+            uint32_t ticks = ticks_to_next_event(&sim);
+            if (ticks > 1) {
+                fast_forward(&sim, ticks - 1);
+            }
+        } else {
+            if (tickless && machine_idle(&sim)) {
+                wait_idle(&sim, epoll_fd);
+            }
+            // Wait for the deadline of the tick. A late tick runs at once to catch up, and is
+            // reported rather than stretching the simulated time.
+            late_ticks = wait_for_tick(&sim, epoll_fd, server_fd);
+            if (late_ticks > 0) tick_overruns++;
+            if (!keep_running) break;
+            PROFILE_RECORD(PROFILE_TICK_LATENESS, monotonic_ns() - tick_due_ns(sim.current_time_ms));
+        }
+        // Handle new connections and/or instructions that arrived since the last tick
+        check_new_commands(&sim, epoll_fd, server_fd, 0);
+
+        if (sim.current_time_ms/1000 != reported_time_s) {
+            reported_time_s = sim.current_time_ms/1000;
+            if (tick_overruns != reported_overruns) {
+                printf("Current time: %d s (%llu ticks overrun)\n", reported_time_s,
+                       (unsigned long long) (tick_overruns - reported_overruns));
+                reported_overruns = tick_overruns;
+            } else {
+                printf("Current time: %d s\n", reported_time_s);
+            }
         }
         // Check the status of the PCBs in the blocked queue
-        check_blocked_queue(&blocked_queue, &command_queue, current_time_ms);
-        // Tasks from the blocked queue could be moved to the command queue, check again
-        usleep(TICKS_MS * 1000/2);
-        check_new_commands(&command_queue, &blocked_queue, &ready_queue,mlfq_rq, scheduler_type, server_fd, current_time_ms);
-
-        // The scheduler handles the READY queue
-        switch (scheduler_type) {
-            case SCHED_FIFO:
-                fifo_scheduler(current_time_ms, &ready_queue, &CPU);
-                break;
-            case SCHED_SJF:
-                sjf_scheduler(current_time_ms, &ready_queue, &CPU);
-                break;
-            case SCHED_RR:
-                rr_scheduler(current_time_ms, &ready_queue, &CPU);
-                break;
-            case SCHED_MLFQ:
-                mlfq_scheduler(current_time_ms, mlfq_rq, &CPU, &current_level);
-                break;
+        PROFILE_BEGIN(PROFILE_BLOCKED);
+        check_blocked_queue(&sim);
+        PROFILE_END(PROFILE_BLOCKED);
+        // Tasks from the blocked queue could be waiting for commands, keep handling events up to
+        // the middle of the tick (a late tick does not wait)
+        if (virtual_time) {
+            while (sim.awaiting_commands > 0 && keep_running) {
+                check_new_commands(&sim, epoll_fd, server_fd, -1);
+            }
+        } else {
+            uint64_t half_ns = tick_due_ns(sim.current_time_ms) + TICK_NS / 2;
+            uint64_t now_ns = monotonic_ns();
+            int wait_ms = (late_ticks == 0 && now_ns < half_ns) ? (int) ((half_ns - now_ns + 999999) / 1000000) : 0;
+            check_new_commands(&sim, epoll_fd, server_fd, wait_ms);
+        }
 
-            default:
-                printf("Unknown scheduler type\n");
-                break;
+        // The scheduler handles the READY queue of every core
+        PROFILE_BEGIN(PROFILE_MACHINE);
+        if (exporter) {
+            uint64_t start_ns = monotonic_ns();
+            run_machine(&sim);
+            publish_metrics(&sim, monotonic_ns() - start_ns);
+        } else {
+            run_machine(&sim);
         }
+        PROFILE_END(PROFILE_MACHINE);
 
-        // Simulate a tick
-        usleep(TICKS_MS * 1000/2);
-        current_time_ms += TICKS_MS;
+        // The rest of the tick is spent handling events until the deadline of the next one
+        sim.current_time_ms += TICKS_MS;
     }
 
-    // Unreachable, because of the infinite loop
+    printf("Scheduler stopped at time %u ms\n", sim.current_time_ms);
+    pool_print_stats(&sim.pcb_pool, "pcb");
+    printf("Messages: %lu received in %lu reads, %lu sent in %lu writes\n",
+           (unsigned long) msgs_received, (unsigned long) reads, (unsigned long) msgs_sent, (unsigned long) writes);
+    if (!virtual_time) {
+        printf("Ticks: %u, %llu overrun, %llu skipped while idle\n", sim.current_time_ms / TICKS_MS,
+               (unsigned long long) tick_overruns, (unsigned long long) idle_ticks);
+    }
+    machine_print_stats(&sim.machine, sim.current_time_ms);
+    memory_print_stats(&sim.memory);
+    metrics_print_summary(&sim.metrics, &sim.machine, sim.current_time_ms);
+    PROFILE_DUMP(stdout);
+    trace_close();
+    sim_destroy(&sim);
+    exporter_stop(exporter);
+    if (timer_fd >= 0) close(timer_fd);
+    close(epoll_fd);
+    close(server_fd);
+    unlink(SOCKET_PATH);
     return 0;
 }
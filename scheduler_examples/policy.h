@@ -0,0 +1,107 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cfs.h"
+#include "memory.h"
+#include "mlfq.h"
+#include "queue.h"
+#include "rr.h"
+
+/*
+ * Interface of a scheduling policy. Every policy fills a scheduler_t with the functions
+ * that manage its ready queue, and is listed in SCHEDULERS (scheduler.c). The simulator only
+ * goes through this table, so adding a policy does not touch the main loop.
+ *
+ * The ready queue of a core is private to the policy: the machine allocates rq_size bytes for
+ * every core, in one contiguous block, and hands them to the functions below.
+ */
+
+// Tunables of the policies, each one reads its own
+typedef struct {
+    rr_config_t rr;
+    mlfq_config_t mlfq;
+    cfs_config_t cfs;
+} scheduler_config_t;
+
+typedef struct scheduler_st {
+    const char *name;
+    size_t rq_size;                 // Size of the ready queue of a core
+
+    // Initialize an empty ready queue sized for capacity pcbs, 0 on success, -1 on failure
+    int (*init)(void *rq, uint32_t capacity, const scheduler_config_t *config);
+    // Optional, release the memory of a ready queue (the pcbs are not freed)
+    void (*destroy)(void *rq);
+    // Add a pcb that requested to RUN, or that was stolen from another core, 1 on success
+    int (*enqueue)(void *rq, pcb_t *pcb);
+    // Take the pcb the policy would run next out of the ready queue, NULL if it is empty
+    pcb_t *(*pick_next)(void *rq);
+    // Take a specific pcb out of the ready queue, NULL if it was not there
+    pcb_t *(*remove)(void *rq, pcb_t *pcb);
+    // Number of pcbs waiting in the ready queue
+    uint32_t (*length)(const void *rq);
+    // Run one tick: account the running pcb, finish or preempt it, dispatch the next one
+    void (*tick)(uint32_t current_time_ms, void *rq, pcb_t **cpu_task);
+    // Ticks until the policy acts on the running pcb before its burst ends (slice, preemption),
+    // at least 1, UINT32_MAX if never. NULL if the policy only acts when bursts end.
+    uint32_t (*ticks_to_event)(const void *rq, const pcb_t *cpu_task, uint32_t current_time_ms);
+    // Optional, the running pcb ran skipped_ms in ticks that were fast forwarded without calling tick.
+    // Only needed by policies that count time tick by tick instead of from slice_start_ms.
+    void (*skip)(void *rq, pcb_t *cpu_task, uint32_t skipped_ms);
+    // Optional, a pcb starts a block
+    void (*on_block)(pcb_t *pcb, uint32_t current_time_ms);
+    // Optional, a pcb leaves the simulation
+    void (*on_exit)(pcb_t *pcb);
+    // Optional, print the statistics of the ready queue of a core
+    void (*print_stats)(const void *rq);
+} scheduler_t;
+
+/**
+ * @brief Fill a configuration with the defaults of every policy
+ */
+void scheduler_config_default(scheduler_config_t *config);
+
+// Command line options of the tunables of the policies and of the memory, shared by ossim,
+// simbench and simsweep. They go in the getopt_long() tables of the front ends, which hand
+// these options to scheduler_config_parse_option()
+#define SCHEDULER_CONFIG_SHORT_OPTIONS "q:r:L:Q:B:l:g:f:F:R:"
+#define SCHEDULER_CONFIG_LONG_OPTIONS \
+    {"rr-quantum", required_argument, NULL, 'q'}, \
+    {"rr-latency", required_argument, NULL, 'r'}, \
+    {"mlfq-levels", required_argument, NULL, 'L'}, \
+    {"mlfq-quanta", required_argument, NULL, 'Q'}, \
+    {"mlfq-boost", required_argument, NULL, 'B'}, \
+    {"cfs-latency", required_argument, NULL, 'l'}, \
+    {"cfs-granularity", required_argument, NULL, 'g'}, \
+    {"frames", required_argument, NULL, 'f'}, \
+    {"fault-ms", required_argument, NULL, 'F'}, \
+    {"replacement", required_argument, NULL, 'R'}
+#define SCHEDULER_CONFIG_USAGE \
+    "          [--rr-quantum MS] [--rr-latency MS]\n" \
+    "          [--mlfq-levels N] [--mlfq-quanta MS,MS,...] [--mlfq-boost MS]\n" \
+    "          [--cfs-latency MS] [--cfs-granularity MS]\n" \
+    "          [--frames N [--fault-ms MS] [--replacement FIFO|LRU|CLOCK|2LIST]]\n"
+
+/**
+ * @brief Apply one option returned by getopt_long() to the tunables
+ *
+ * @param opt The option, as returned by getopt_long()
+ * @param arg Its argument (optarg)
+ * @return 1 if it is one of SCHEDULER_CONFIG_LONG_OPTIONS, 0 if not, -1 if its value is invalid
+ *         (the error is printed)
+ */
+int scheduler_config_parse_option(scheduler_config_t *config, memory_config_t *memory, int opt, const char *arg);
+
+// The policies, see their headers
+extern const scheduler_t FIFO_SCHEDULER;
+extern const scheduler_t SJF_SCHEDULER;
+extern const scheduler_t SRTF_SCHEDULER;
+extern const scheduler_t RR_SCHEDULER;
+extern const scheduler_t MLFQ_SCHEDULER;
+extern const scheduler_t STRIDE_SCHEDULER;
+extern const scheduler_t LOTTERY_SCHEDULER;
+extern const scheduler_t CFS_SCHEDULER;
+
+#endif //POLICY_H
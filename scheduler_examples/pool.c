@@ -0,0 +1,69 @@
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int pool_init(pool_t *pool, size_t elem_size, uint32_t capacity) {
+    // A free slot stores the pointer to the next one, keep them aligned for it
+    if (elem_size < sizeof(void *)) elem_size = sizeof(void *);
+    elem_size = (elem_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    *pool = (pool_t) {.elem_size = elem_size, .capacity = capacity};
+    if (capacity == 0) return 0;
+
+    pool->slab = malloc(elem_size * capacity);
+    if (!pool->slab) return -1;
+
+    // Thread the free list through the slots, in address order
+    for (uint32_t i = 0; i < capacity; i++) {
+        void **slot = (void **) (pool->slab + i * elem_size);
+        *slot = (i + 1 < capacity) ? pool->slab + (i + 1) * elem_size : NULL;
+    }
+    pool->free_list = pool->slab;
+    return 0;
+}
+
+void pool_destroy(pool_t *pool) {
+    free(pool->slab);
+    pool->slab = NULL;
+    pool->free_list = NULL;
+    pool->capacity = 0;
+}
+
+static int pool_owns(const pool_t *pool, const void *ptr) {
+    const char *p = ptr;
+    return pool->slab && p >= pool->slab && p < pool->slab + pool->elem_size * pool->capacity;
+}
+
+void *pool_alloc(pool_t *pool) {
+    void *ptr = pool->free_list;
+    if (ptr) {
+        pool->free_list = *(void **) ptr;
+    } else {
+        ptr = malloc(pool->elem_size);
+        if (!ptr) return NULL;
+        pool->fallbacks++;
+    }
+    pool->allocs++;
+    if (++pool->in_use > pool->peak) pool->peak = pool->in_use;
+    return ptr;
+}
+
+void pool_free(pool_t *pool, void *ptr) {
+    if (!ptr) return;
+    if (pool_owns(pool, ptr)) {
+        *(void **) ptr = pool->free_list;
+        pool->free_list = ptr;
+    } else {
+        free(ptr);
+    }
+    pool->frees++;
+    pool->in_use--;
+}
+
+void pool_print_stats(const pool_t *pool, const char *name) {
+    printf("Pool %s: capacity %u, in use %u, peak %u, allocs %llu, frees %llu, heap fallbacks %llu\n",
+           name, pool->capacity, pool->in_use, pool->peak,
+           (unsigned long long) pool->allocs, (unsigned long long) pool->frees,
+           (unsigned long long) pool->fallbacks);
+}
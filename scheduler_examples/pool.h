@@ -0,0 +1,65 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed-size object pool: a single slab allocated up front and a free list threaded
+ * through the free slots, so allocating and freeing are a couple of pointer moves.
+ * When the slab is exhausted, allocations fall back to malloc() and are counted,
+ * which tells us the pool was undersized.
+ */
+typedef struct {
+    size_t elem_size;       // Size of each slot in bytes
+    uint32_t capacity;      // Number of slots in the slab
+    char *slab;             // The slots
+    void *free_list;        // Next free slot, each free slot points to the next one
+    // Statistics
+    uint32_t in_use;        // Objects currently allocated (slab and fallback)
+    uint32_t peak;          // Highest value of in_use
+    uint64_t allocs;        // Total number of allocations
+    uint64_t frees;         // Total number of frees
+    uint64_t fallbacks;     // Allocations served by malloc() because the slab was full
+} pool_t;
+
+/**
+ * @brief Allocate the slab of a pool
+ *
+ * @param pool The pool to initialize
+ * @param elem_size The size of the objects
+ * @param capacity The number of objects in the slab
+ * @return 0 on success, -1 if the slab could not be allocated
+ */
+int pool_init(pool_t *pool, size_t elem_size, uint32_t capacity);
+
+/**
+ * @brief Release the slab of a pool
+ *
+ * Objects still allocated from the slab become invalid.
+ */
+void pool_destroy(pool_t *pool);
+
+/**
+ * @brief Allocate an object from the pool
+ *
+ * @return The object (not initialized), or NULL if the pool is full and malloc() failed
+ */
+void *pool_alloc(pool_t *pool);
+
+/**
+ * @brief Return an object to the pool
+ *
+ * @param ptr An object returned by pool_alloc() on the same pool
+ */
+void pool_free(pool_t *pool, void *ptr);
+
+/**
+ * @brief Print the allocation statistics of a pool
+ *
+ * @param pool The pool
+ * @param name The name printed with the statistics
+ */
+void pool_print_stats(const pool_t *pool, const char *name);
+
+#endif //POOL_H
@@ -0,0 +1,87 @@
+#include "profile.h"
+
+#if PROFILE_ENABLED
+
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1u << SUB_BUCKET_BITS)     // Exact buckets below this value
+#define HALF_BUCKETS (SUB_BUCKETS / 2)          // Buckets per power of two above it
+// The highest bit of a uint64_t is 63, so its value is shifted by at most 63 - (SUB_BUCKET_BITS - 1)
+#define HISTOGRAM_BUCKETS (SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * HALF_BUCKETS)
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} histogram_t;
+
+static const char *PHASE_NAMES[PROFILE_PHASES] = {
+    [PROFILE_TICK_LATENESS] = "tick lateness",
+    [PROFILE_COMMANDS] = "commands",
+    [PROFILE_FLUSH] = "flush",
+    [PROFILE_BLOCKED] = "blocked queue",
+    [PROFILE_MACHINE] = "run_machine",
+    [PROFILE_SCHEDULER] = "scheduler tick",
+};
+
+static _Thread_local histogram_t histograms[PROFILE_PHASES];
+
+/**
+ * @brief Bucket of a value: its top SUB_BUCKET_BITS bits and the number of bits below them
+ */
+static uint32_t bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) return (uint32_t) value;
+    uint32_t shift = (uint32_t) (63 - __builtin_clzll(value)) - (SUB_BUCKET_BITS - 1);
+    return SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + (uint32_t) ((value >> shift) - HALF_BUCKETS);
+}
+
+/**
+ * @brief Highest value that falls in a bucket
+ */
+static uint64_t bucket_highest(uint32_t index) {
+    if (index < SUB_BUCKETS) return index;
+    uint32_t shift = (index - SUB_BUCKETS) / HALF_BUCKETS + 1;
+    uint64_t lowest = (uint64_t) ((index - SUB_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS) << shift;
+    return lowest + ((uint64_t) 1 << shift) - 1;
+}
+
+void profile_record(profile_phase_t phase, uint64_t ns) {
+    histogram_t *histogram = &histograms[phase];
+    histogram->counts[bucket_index(ns)]++;
+    histogram->total++;
+    histogram->sum_ns += ns;
+    if (ns > histogram->max_ns) histogram->max_ns = ns;
+}
+
+/**
+ * @brief Value below which a fraction of the records fall, up to the precision of the buckets
+ */
+static uint64_t percentile(const histogram_t *histogram, double fraction) {
+    uint64_t rank = (uint64_t) (fraction * (double) histogram->total + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t highest = bucket_highest(i);
+            return (highest < histogram->max_ns) ? highest : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+void profile_dump(FILE *out) {
+    fprintf(out, "Profile (us)         count       mean        p50        p90        p99      p99.9        max\n");
+    for (int phase = 0; phase < PROFILE_PHASES; phase++) {
+        const histogram_t *histogram = &histograms[phase];
+        if (histogram->total == 0) continue;
+        fprintf(out, "%-15s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", PHASE_NAMES[phase],
+                (unsigned long long) histogram->total, (double) histogram->sum_ns / histogram->total / 1000.0,
+                percentile(histogram, 0.5) / 1000.0, percentile(histogram, 0.9) / 1000.0,
+                percentile(histogram, 0.99) / 1000.0, percentile(histogram, 0.999) / 1000.0,
+                histogram->max_ns / 1000.0);
+    }
+    fflush(out);
+}
+
+#endif
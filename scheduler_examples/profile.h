@@ -0,0 +1,64 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Self-instrumentation of the hot path of the simulator. Every phase of a tick is timed with
+ * CLOCK_MONOTONIC_RAW and recorded in a log-bucketed (HDR style) histogram: values below 32 ns
+ * have a bucket each, above that every power of two is split in 16 buckets, so any latency from
+ * a nanosecond to centuries is kept with an error of at most 1/16 in a fixed 8 KB per phase.
+ *
+ * Like DBG in debug.h, this is only active if NDEBUG is not defined (CMake Debug builds), and
+ * the macros expand to nothing otherwise. Define PROFILE to also profile an optimized build.
+ * The histograms are per thread, so the threads of simsweep do not share them.
+ */
+#if !defined(NDEBUG) || defined(PROFILE)
+  #define PROFILE_ENABLED 1
+#else
+  #define PROFILE_ENABLED 0
+#endif
+
+typedef enum {
+    PROFILE_TICK_LATENESS = 0,  // How late a real-time tick started after its deadline
+    PROFILE_COMMANDS,           // Handling one batch of socket events (connections and requests)
+    PROFILE_FLUSH,              // Writing the pending messages of the applications
+    PROFILE_BLOCKED,            // check_blocked_queue()
+    PROFILE_MACHINE,            // run_machine(): every core, then work stealing
+    PROFILE_SCHEDULER,          // One tick of the policy on one core
+    PROFILE_PHASES
+} profile_phase_t;
+
+#if PROFILE_ENABLED
+
+#include <time.h>
+
+static inline uint64_t profile_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * @brief Record a latency in the histogram of a phase
+ */
+void profile_record(profile_phase_t phase, uint64_t ns);
+
+/**
+ * @brief Print the count, mean, percentiles and maximum of every phase that was recorded
+ */
+void profile_dump(FILE *out);
+
+  #define PROFILE_BEGIN(phase) uint64_t profile_start_##phase = profile_now_ns()
+  #define PROFILE_END(phase) profile_record(phase, profile_now_ns() - profile_start_##phase)
+  #define PROFILE_RECORD(phase, ns) profile_record(phase, ns)
+  #define PROFILE_DUMP(out) profile_dump(out)
+#else
+  #define PROFILE_BEGIN(phase)
+  #define PROFILE_END(phase) ((void)0)
+  #define PROFILE_RECORD(phase, ns) ((void)0)
+  #define PROFILE_DUMP(out) ((void)0)
+#endif
+
+#endif //PROFILE_H
@@ -3,8 +3,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-pcb_t *new_pcb(pid_t pid, uint32_t sockfd, uint32_t time_ms) {
-    pcb_t * new_task = malloc(sizeof(pcb_t));
+pcb_t *new_pcb(pool_t *pool, pid_t pid, uint32_t sockfd, uint32_t time_ms) {
+    pcb_t * new_task = pool ? pool_alloc(pool) : malloc(sizeof(pcb_t));
     if (!new_task) return NULL;
 
     new_task->pid = pid;
@@ -13,59 +13,101 @@ pcb_t *new_pcb(pid_t pid, uint32_t sockfd, uint32_t time_ms) {
     new_task->sockfd = sockfd;
     new_task->time_ms = time_ms;
     new_task->ellapsed_time_ms = 0;
+    new_task->last_update_time_ms = 0;
+    new_task->prev = NULL;
+    new_task->next = NULL;
+    new_task->queue = NULL;
+    new_task->heap_index = HEAP_NONE;
+    new_task->mlfq_level = 0;
+    new_task->mlfq_used_ms = 0;
+    new_task->mlfq_epoch = 0;
+    new_task->nice = 0;
+    new_task->stride_pass = 0;
+    new_task->lottery_slot = LOTTERY_NONE;
+    new_task->vruntime = 0;
+    new_task->cfs_seq = 0;
+    new_task->rb_parent = NULL;
+    new_task->rb_left = NULL;
+    new_task->rb_right = NULL;
+    new_task->rb_red = 0;
+    new_task->cfs = NULL;
+    new_task->cfs_home = NULL;
+    new_task->stride_home = NULL;
+    new_task->pages = NULL;
+    new_task->n_pages = 0;
+    new_task->page_table = NULL;
+    new_task->next_pages.count = 0;
+    new_task->arrival_time_ms = 0;
+    new_task->first_run_time_ms = UINT32_MAX;   // METRICS_NONE
+    new_task->completion_time_ms = 0;
+    new_task->state_since_ms = 0;
+    new_task->ready_wait_ms = 0;
+    new_task->blocked_ms = 0;
+    new_task->cpu_ms = 0;
+    new_task->page_faults = 0;
+    new_task->metered = 1;
+    new_task->protocol = 1;
+    new_task->socket_drained = 0;
+    new_task->inbox_bytes = 0;
+    new_task->outbox_count = 0;
+    new_task->flush_next = NULL;
+    new_task->channel = NULL;
+    new_task->request_efd = -1;
+    new_task->reply_efd = -1;
+    new_task->n_passed_fds = 0;
 
     return new_task;
 }
 
+void free_pcb(pool_t *pool, pcb_t *pcb) {
+    if (pool) {
+        pool_free(pool, pcb);
+    } else {
+        free(pcb);
+    }
+}
+
 int enqueue_pcb(queue_t* q, pcb_t* task) {
-    queue_elem_t* elem = malloc(sizeof(queue_elem_t));
-    if (!elem) return 0;
+    if (pcb_is_queued(task)) return 0;
 
-    elem->pcb = task;
-    elem->next = NULL;
+    task->queue = q;
+    task->next = NULL;
+    task->prev = q->tail;
 
     if (q->tail) {
-        q->tail->next = elem;
+        q->tail->next = task;
     } else {
-        q->head = elem;
+        q->head = task;
     }
-    q->tail = elem;
+    q->tail = task;
+    q->length++;
     return 1;
 }
 
 pcb_t* dequeue_pcb(queue_t* q) {
     if (!q || !q->head) return NULL;
+    return remove_pcb(q, q->head);
+}
 
-    queue_elem_t* node = q->head;
-    pcb_t* task = node->pcb;
-
-    q->head = node->next;
-    if (!q->head)
-        q->tail = NULL;
-
-    free(node);
+pcb_t *remove_pcb(queue_t* q, pcb_t* task) {
+    if (task->queue != q) {
+        printf("PCB not found in queue\n");
+        return NULL;
+    }
+    if (task->prev) {
+        task->prev->next = task->next;
+    } else {
+        q->head = task->next;
+    }
+    if (task->next) {
+        task->next->prev = task->prev;
+    } else {
+        q->tail = task->prev;
+    }
+    task->prev = NULL;
+    task->next = NULL;
+    task->queue = NULL;
+    q->length--;
     return task;
 }
 
-queue_elem_t *remove_queue_elem(queue_t* q, queue_elem_t* elem) {
-    queue_elem_t* it = q->head;
-    queue_elem_t* prev = NULL;
-    while (it != NULL) {
-        if (it == elem) {
-            // Remove elem from queue
-            if (prev) {
-                prev->next = it->next;
-            } else {
-                q->head = it->next;
-            }
-            if (it == q->tail) {
-                q->tail = prev;
-            }
-            return it;
-        }
-        prev = it;
-        it = it->next;
-    }
-    printf("Queue element not found in queue\n");
-    return NULL;
-}
\ No newline at end of file
@@ -2,6 +2,10 @@
 #define QUEUE_H
 #include <stdint.h>
 
+#include "msg.h"
+#include "pool.h"
+#include "shm.h"
+
 typedef enum  {
     TASK_COMMAND = 0,   // Task has connected and is waiting for instructions
     TASK_BLOCKED,       // Task is blocked (waiting/IO wait)
@@ -10,42 +14,116 @@ typedef enum  {
     TASK_TERMINATED,    // Task has been terminated and will be removed
 } task_status_en;
 
+typedef struct queue_st queue_t;
+struct cfs_st;
+struct stride_st;
+struct page_table_st;
+
+#define HEAP_NONE UINT32_MAX    // heap_index of a pcb that is not in a heap
+#define LOTTERY_NONE UINT32_MAX // lottery_slot of a pcb that is not in a lottery
+
 // Define the Process Control Block (PCB) structure
 typedef struct pcb_st{
     int32_t pid;                   // Process ID
     task_status_en status;         // Current status of the task defined by the pcb
-    uint32_t time_ms;              // Time requested by application in milliseconds
+    uint32_t time_ms;              // Time requested by application in milliseconds, plus its page faults
     uint32_t ellapsed_time_ms;     // Time ellapsed since start in milliseconds
     uint32_t slice_start_ms;       // Time when the current time slice started
     uint32_t sockfd;               // Socket file descriptor for communication with the application
     uint32_t last_update_time_ms;  // Last time the PCB was updataed
+    // Queue links, the pcb is its own queue element (a pcb is in at most one queue)
+    struct pcb_st *prev;           // Previous pcb in the queue
+    struct pcb_st *next;           // Next pcb in the queue
+    queue_t *queue;                // Queue the pcb is in, NULL if none
+    uint32_t heap_index;           // Position in the heap the pcb is in, HEAP_NONE if none
+    // State of the policies. Every policy keeps its per pcb fields here, so that its ready queue
+    // needs no allocation per pcb; each block below is only read and written by its own policy.
+    // MLFQ state, kept between bursts
+    uint32_t mlfq_level;           // Priority level, 0 is the highest
+    uint32_t mlfq_used_ms;         // CPU time used at the current level
+    uint32_t mlfq_epoch;           // Boost epoch the level belongs to
+    // Proportional share state, see stride.h and lottery.h
+    int32_t nice;                  // Nice value of the current burst, sent with its RUN
+    uint64_t stride_pass;          // Virtual time of the pcb in the stride scheduler
+    struct stride_st *stride_home; // Stride ready queue whose pass the stride_pass follows, NULL if none yet
+    uint32_t lottery_slot;         // Slot in the lottery the pcb is in, LOTTERY_NONE if none
+    // CFS state, see cfs.h
+    uint64_t vruntime;             // CPU time used in us, scaled by the weight of the nice value
+    uint64_t cfs_seq;              // Insertion order in the tree, to break ties in FIFO order
+    struct pcb_st *rb_parent;      // Links of the red-black tree of the CFS ready queue
+    struct pcb_st *rb_left;
+    struct pcb_st *rb_right;
+    uint32_t rb_red;               // Color of the node in the tree
+    struct cfs_st *cfs;            // CFS ready queue the pcb is in, NULL if none
+    struct cfs_st *cfs_home;       // CFS ready queue whose min_vruntime the vruntime follows, NULL if none yet
+    // Paging, see memory.h
+    const uint32_t *pages;         // Pages of the current burst, until its first dispatch touches them
+    uint32_t n_pages;
+    struct page_table_st *page_table; // Page table, NULL until the first burst with pages
+    page_info_t next_pages;        // Pages received for the next RUN, pages points to them once it is handled
+    // Metrics, see metrics.h
+    uint32_t arrival_time_ms;      // Time the application connected
+    uint32_t first_run_time_ms;    // Time of the first dispatch, METRICS_NONE if it never ran
+    uint32_t completion_time_ms;   // Time of the last DONE
+    uint32_t state_since_ms;       // Time the pcb entered the ready or the blocked queue
+    uint32_t ready_wait_ms;        // Total time spent in ready queues
+    uint32_t blocked_ms;           // Total time spent blocked
+    uint32_t cpu_ms;               // Total time spent running
+    uint32_t page_faults;          // Page faults charged to the bursts
+    uint32_t metered;              // Recorded when it leaves, 0 if its HELLO asked for MSG_HELLO_NO_METRICS
+    // Connection buffers, see the protocol in msg.h
+    uint32_t protocol;             // Protocol version of the application, 1 until it sends a HELLO
+    uint32_t socket_drained;       // The last read() emptied the socket, wait for the next edge
+    uint32_t inbox_bytes;          // Bytes received and not handled yet
+    uint32_t outbox_count;         // Messages waiting to be flushed
+    struct pcb_st *flush_next;     // Next pcb with messages waiting to be flushed
+    msg_t inbox[MSG_BATCH_MAX];    // Received messages, the last one may be incomplete
+    msg_t outbox[MSG_BATCH_MAX];   // Messages to send
+    // Shared-memory transport, see shm.h
+    struct shm_channel_st *channel; // Rings used instead of the socket, NULL if none
+    int32_t request_efd;           // eventfd signalled by the application, -1 if none
+    int32_t reply_efd;             // eventfd signalled to the application, -1 if none
+    int32_t passed_fds[SHM_FD_COUNT]; // Descriptors received with the HELLO, indexed by SHM_FD_*
+    uint32_t n_passed_fds;         // Descriptors received so far, the channel is mapped once all arrived
 } pcb_t;
 
-// Define singly linked list elements
-typedef struct queue_elem_st queue_elem_t;
-typedef struct queue_elem_st {
-    pcb_t *pcb;
-    queue_elem_t *next;
-} queue_elem_t;
-
 // Define the queue structure
-// We define the head and the tail to make it easier to enqueue and dequeue
+// A doubly linked list through the pcbs themselves, so that enqueue, dequeue and removing
+// any pcb are O(1) and never allocate. We define the head and the tail to make it easier
+// to enqueue and dequeue.
 typedef struct queue_st  {
-    queue_elem_t* head;
-    queue_elem_t* tail;
+    pcb_t* head;
+    pcb_t* tail;
+    uint32_t length;        // Number of pcbs in the queue
 } queue_t;
 
+/**
+ * @brief Whether a pcb is in a ready queue of any policy: a queue, a heap, a lottery or a CFS tree
+ */
+static inline int pcb_is_queued(const pcb_t *pcb) {
+    return pcb->queue || pcb->heap_index != HEAP_NONE || pcb->lottery_slot != LOTTERY_NONE || pcb->cfs;
+}
+
 /**
  * @brief Create a new pcb (process control block)
  *
  * This function allocates memory for a new pcb and initializes its fields.
  *
+ * @param pool The pool to allocate the pcb from, or NULL to use malloc()
  * @param pid The process ID of the task
  * @param sockfd The socket file descriptor for communication with the application
  * @param time_ms a time field (either for run or block)
- * @return
+ * @return The new pcb, or NULL on failure
  */
-pcb_t *new_pcb(int32_t pid, uint32_t sockfd, uint32_t time_ms);
+pcb_t *new_pcb(pool_t *pool, int32_t pid, uint32_t sockfd, uint32_t time_ms);
+
+/**
+ * @brief Free a pcb created by new_pcb()
+ *
+ * @param pool The pool the pcb was allocated from (NULL for malloc())
+ * @param pcb The pcb to free, it must not be in a queue
+ */
+void free_pcb(pool_t *pool, pcb_t *pcb);
 
 /**
  * @brief Enqueue a pcb into the queue
@@ -54,7 +132,7 @@ pcb_t *new_pcb(int32_t pid, uint32_t sockfd, uint32_t time_ms);
  *
  * @param q The queue to which the pcb will be added
  * @param task The pcb to be added to the queue
- * @return The number of pcb enqueued (0 on failure)
+ * @return The number of pcb enqueued (0 on failure, if the pcb is already in a queue or heap)
  */
 int enqueue_pcb(queue_t* q, pcb_t* task);
 
@@ -69,16 +147,27 @@ int enqueue_pcb(queue_t* q, pcb_t* task);
 pcb_t* dequeue_pcb(queue_t* q);
 
 /**
- * @brief Remove a specific element from the queue
+ * @brief Remove a specific pcb from the queue
  *
- * This function removes a specific element from the queue.
- * Neither the element, nor the pcb inside the element, are freed.
+ * This function removes a specific pcb from the queue in O(1). The pcb is not freed.
  *
- * @param q The queue from which the element will be removed
- * @param elem The element to be removed from the queue
- * @return The removed element, or NULL if the element was not found
+ * @param q The queue from which the pcb will be removed
+ * @param task The pcb to be removed from the queue
+ * @return The removed pcb, or NULL if the pcb was not in this queue
  */
-queue_elem_t *remove_queue_elem(queue_t* q, queue_elem_t* elem);
+pcb_t *remove_pcb(queue_t* q, pcb_t* task);
 
+/**
+ * @brief Function that delivers a message (ACK or DONE) to the application of a pcb
+ *
+ * The simulator uses it to keep track of the applications it sent a DONE to, and
+ * in-process simulations use it to replace the sockets altogether (see sim.h).
+ *
+ * @param context The context given along with the notifier
+ * @param pcb The pcb of the application
+ * @param request The message type (PROCESS_REQUEST_ACK or PROCESS_REQUEST_DONE)
+ * @param current_time_ms The current time in milliseconds, sent with the message
+ */
+typedef void (*pcb_notifier_t)(void *context, pcb_t *pcb, process_request_t request, uint32_t current_time_ms);
 
 #endif //QUEUE_H
@@ -0,0 +1,102 @@
+#include "memory.h"
+
+/*
+ * Page replacement policies. The frames are linked through themselves, so every operation
+ * but the victim scans of CLOCK and 2LIST is O(1), and those are amortized O(1): a frame is
+ * skipped at most once per reference.
+ */
+
+//---- FIFO: evict the page loaded first, references do not matter
+
+static void fifo_loaded(memory_t *memory, frame_t *frame) {
+    frame_list_push(memory, FRAME_LIST_RESIDENT, frame);
+}
+
+static frame_t *list_victim(memory_t *memory) {
+    frame_t *frame = memory->lists[FRAME_LIST_RESIDENT].head;
+    frame_list_remove(memory, frame);
+    return frame;
+}
+
+static void list_released(memory_t *memory, frame_t *frame) {
+    frame_list_remove(memory, frame);
+}
+
+const replacement_t FIFO_REPLACEMENT = {
+    .name = "FIFO",
+    .loaded = fifo_loaded,
+    .referenced = NULL,
+    .victim = list_victim,
+    .released = list_released
+};
+
+//---- LRU: every reference moves the frame to the tail, the head is the least recently used
+
+static void lru_referenced(memory_t *memory, frame_t *frame) {
+    frame_list_remove(memory, frame);
+    frame_list_push(memory, FRAME_LIST_RESIDENT, frame);
+}
+
+const replacement_t LRU_REPLACEMENT = {
+    .name = "LRU",
+    .loaded = fifo_loaded,
+    .referenced = lru_referenced,
+    .victim = list_victim,
+    .released = list_released
+};
+
+//---- CLOCK: a hand sweeps the frames in place, clearing reference bits, and evicts the first
+// frame it finds unreferenced
+
+static void clock_referenced(memory_t *memory, frame_t *frame) {
+    frame->referenced = 1;
+}
+
+static frame_t *clock_victim(memory_t *memory) {
+    // Only called when no frame is free, so every frame holds a page
+    while (1) {
+        frame_t *frame = &memory->frames[memory->hand];
+        memory->hand = (memory->hand + 1) % memory->config.frames;
+        if (!frame->referenced) return frame;
+        frame->referenced = 0;
+    }
+}
+
+const replacement_t CLOCK_REPLACEMENT = {
+    .name = "CLOCK",
+    .loaded = clock_referenced,
+    .referenced = clock_referenced,
+    .victim = clock_victim,
+    .released = NULL
+};
+
+//---- 2LIST: approximate LRU with an active and an inactive list, like the page cache of Linux.
+// A reference only sets the bit of the frame, the lists are fixed up when a victim is needed:
+// new pages start inactive, a referenced inactive page is promoted, and the active list is
+// aged into the inactive one whenever it is the longer of the two.
+
+static frame_t *two_list_victim(memory_t *memory) {
+    frame_list_t *inactive = &memory->lists[FRAME_LIST_RESIDENT];
+    frame_list_t *active = &memory->lists[FRAME_LIST_ACTIVE];
+    while (1) {
+        if (inactive->length == 0 || inactive->length < active->length) {
+            frame_t *frame = active->head;
+            frame_list_remove(memory, frame);
+            frame->referenced = 0;
+            frame_list_push(memory, FRAME_LIST_RESIDENT, frame);
+        }
+        frame_t *frame = inactive->head;
+        frame_list_remove(memory, frame);
+        if (!frame->referenced) return frame;
+        frame->referenced = 0;
+        frame_list_push(memory, FRAME_LIST_ACTIVE, frame);
+    }
+}
+
+const replacement_t TWO_LIST_REPLACEMENT = {
+    .name = "2LIST",
+    .loaded = fifo_loaded,
+    .referenced = clock_referenced,
+    .victim = two_list_victim,
+    .released = list_released
+};
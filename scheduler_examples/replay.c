@@ -0,0 +1,132 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int load_trace(const char *filename, trace_t *trace) {
+    if (load_bursts(&trace->array, filename) <= 0) {
+        fprintf(stderr, "Failed to read burst file %s\n", filename);
+        return -1;
+    }
+    trace->bursts = trace->array.bursts;
+    trace->count = trace->array.count;
+    return 0;
+}
+
+void free_trace(trace_t *trace) {
+    free_bursts(&trace->array);
+    trace->bursts = NULL;
+    trace->count = 0;
+}
+
+/**
+ * @brief Deliver the messages of the simulation to the simulated applications
+ */
+static void replay_notifier(void *context, pcb_t *pcb, process_request_t request, uint32_t current_time_ms) {
+    replay_t *replay = context;
+    replay_app_t *app = &replay->apps[pcb->pid - 1];
+    if (request == PROCESS_REQUEST_ACK) {
+        if (app->start_time_ms == UINT32_MAX) app->start_time_ms = current_time_ms;
+    } else if (request == PROCESS_REQUEST_DONE) {
+        app->finish_time_ms = current_time_ms;
+        enqueue_pcb(&replay->command_queue, pcb);
+    }
+}
+
+int replay_init(replay_t *replay, const scheduler_t *scheduler, uint32_t n_cpus, const scheduler_config_t *config,
+                const memory_config_t *memory, const trace_t *traces, uint32_t n_traces, uint32_t n_apps) {
+    *replay = (replay_t) {.n_apps = n_apps};
+    replay->apps = calloc(n_apps, sizeof(replay_app_t));
+    if (!replay->apps) return -1;
+    if (sim_init(&replay->sim, scheduler, n_cpus, n_apps, config, memory, replay_notifier, replay) < 0) {
+        free(replay->apps);
+        return -1;
+    }
+
+    // All applications connect at time 0
+    for (uint32_t i = 0; i < n_apps; i++) {
+        pcb_t *pcb = sim_arrive(&replay->sim, 0);
+        if (!pcb) {
+            replay_destroy(replay);
+            return -1;
+        }
+        replay->apps[pcb->pid - 1] = (replay_app_t) {
+            .trace = &traces[i % n_traces],
+            .start_time_ms = UINT32_MAX
+        };
+        enqueue_pcb(&replay->command_queue, pcb);
+    }
+    return 0;
+}
+
+/**
+ * @brief Issue the next request of every application waiting for commands.
+ *
+ * This is the in-process equivalent of the applications answering a DONE with their
+ * next RUN or BLOCK request, and of check_new_commands() handling it.
+ *
+ * @return The number of applications that ran out of bursts
+ */
+static uint32_t issue_commands(replay_t *replay) {
+    uint32_t finished = 0;
+    pcb_t *pcb;
+    while ((pcb = dequeue_pcb(&replay->command_queue)) != NULL) {
+        replay_app_t *app = &replay->apps[pcb->pid - 1];
+        if (app->block_pending) {
+            const burst_t *burst = &app->trace->bursts[app->next_burst - 1];
+            app->block_pending = 0;
+            sim_request_block(&replay->sim, pcb, burst->block_time_ms);
+        } else if (app->next_burst < app->trace->count) {
+            const burst_t *burst = &app->trace->bursts[app->next_burst++];
+            app->block_pending = (burst->block_time_ms > 0);
+            sim_request_run(&replay->sim, pcb, burst->burst_time_ms, burst->nice,
+                            burst_pages(&app->trace->array, burst), burst->n_pages);
+        } else {
+            // No more bursts, the application disconnects
+            sim_leave(&replay->sim, pcb);
+            finished++;
+        }
+    }
+    return finished;
+}
+
+uint32_t replay_run(replay_t *replay) {
+    sim_t *sim = &replay->sim;
+    uint32_t finished = 0;
+    while (1) {
+        finished += issue_commands(replay);
+        if (finished == replay->n_apps) break;
+
+        // Skip the ticks in which nothing happens, as ossim does in virtual time
+        uint32_t ticks = ticks_to_next_event(sim);
+        if (ticks > 1) {
+            fast_forward(sim, ticks - 1);
+        }
+
+        check_blocked_queue(sim);
+        finished += issue_commands(replay);
+        run_machine(sim);
+        sim->current_time_ms += TICKS_MS;
+    }
+
+    uint32_t makespan_ms = 0;
+    for (uint32_t i = 0; i < replay->n_apps; i++) {
+        if (replay->apps[i].finish_time_ms > makespan_ms) makespan_ms = replay->apps[i].finish_time_ms;
+    }
+    return makespan_ms;
+}
+
+double replay_mean_turnaround_ms(const replay_t *replay) {
+    if (replay->n_apps == 0) return 0;
+    double turnaround_ms = 0;
+    for (uint32_t i = 0; i < replay->n_apps; i++) {
+        turnaround_ms += replay->apps[i].finish_time_ms - replay->apps[i].start_time_ms;
+    }
+    return turnaround_ms / replay->n_apps;
+}
+
+void replay_destroy(replay_t *replay) {
+    sim_destroy(&replay->sim);
+    free(replay->apps);
+    replay->apps = NULL;
+}
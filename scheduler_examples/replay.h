@@ -0,0 +1,91 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+
+#include "burst_queue.h"
+#include "memory.h"
+#include "policy.h"
+#include "queue.h"
+#include "sim.h"
+
+/*
+ * In-process replay of burst files, used by simbench and simsweep.
+ *
+ * Each burst file (the same CSV format used by app-io, or its compiled form) becomes one or
+ * more simulated applications. Instead of sending RUN/BLOCK requests over the socket, the
+ * requests are synthesised from the bursts and handed to the same simulation used by ossim,
+ * following the same tick order. The applications arrive in the order of the files (cycling
+ * through them for the copies), so the results match a virtual time run of the scheduler whose
+ * applications connect in that order; another arrival order may give other results.
+ *
+ * A replay owns its whole simulation, so independent replays can run in parallel threads.
+ */
+
+typedef struct {
+    burst_array_t array;            // The loaded burst file
+    const burst_t *bursts;          // Bursts of the trace (shared between copies)
+    uint32_t count;                 // Number of bursts
+} trace_t;
+
+typedef struct {
+    const trace_t *trace;           // Trace replayed by this application
+    uint32_t next_burst;            // Index of the burst of the next RUN request
+    int block_pending;              // The BLOCK of the current burst still has to be requested
+    uint32_t start_time_ms;         // Time of the first ACK
+    uint32_t finish_time_ms;        // Time of the last DONE
+} replay_app_t;
+
+typedef struct {
+    sim_t sim;
+    replay_app_t *apps;             // The simulated applications, indexed by the pid of their pcb - 1
+    uint32_t n_apps;
+    queue_t command_queue;          // PCBs that received a DONE and must issue their next request
+} replay_t;
+
+/**
+ * @brief Load a burst file (CSV or compiled) into a contiguous array of bursts.
+ *
+ * @return 0 on success, -1 on failure (reported on stderr)
+ */
+int load_trace(const char *filename, trace_t *trace);
+
+/**
+ * @brief Release the bursts of a trace
+ */
+void free_trace(trace_t *trace);
+
+/**
+ * @brief Prepare a replay where the applications all arrive at time 0
+ *
+ * Application i replays traces[i % n_traces].
+ *
+ * @param scheduler The policy of the cores
+ * @param n_cpus The number of cores
+ * @param config The tunables of the policies, or NULL for the defaults
+ * @param memory The frames and the page replacement, or NULL to leave paging off
+ * @return 0 on success, -1 on failure
+ */
+int replay_init(replay_t *replay, const scheduler_t *scheduler, uint32_t n_cpus, const scheduler_config_t *config,
+                const memory_config_t *memory, const trace_t *traces, uint32_t n_traces, uint32_t n_apps);
+
+/**
+ * @brief Simulate all applications to completion
+ *
+ * The utilisation of the cores and the metrics of the applications are left in replay->sim.
+ *
+ * @return The simulated time in milliseconds when the last application finished
+ */
+uint32_t replay_run(replay_t *replay);
+
+/**
+ * @brief Mean time from the first ACK to the last DONE of the applications
+ */
+double replay_mean_turnaround_ms(const replay_t *replay);
+
+/**
+ * @brief Release the memory of a replay
+ */
+void replay_destroy(replay_t *replay);
+
+#endif //REPLAY_H
@@ -4,75 +4,143 @@
 #include "rr.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
 #include "msg.h"
+#include "policy.h"
 
-#define TIME_SLICE_MS 500
+void rr_config_default(rr_config_t *config) {
+    config->quantum_ms = RR_DEFAULT_QUANTUM_MS;
+    config->target_latency_ms = 0;
+}
 
-void rr_scheduler(uint32_t current_time_ms, queue_t *rq, pcb_t **cpu_task) {
+void rr_init(rr_t *rr, const rr_config_t *config) {
+    *rr = (rr_t) {0};
+    if (config) {
+        rr->config = *config;
+    } else {
+        rr_config_default(&rr->config);
+    }
+}
+
+uint32_t rr_quantum(const rr_t *rr) {
+    uint32_t quantum_ms = rr->config.quantum_ms;
+    if (rr->config.target_latency_ms > 0) {
+        // Shorter slices when many pcbs wait, so each one waits at most about the target latency
+        uint32_t share_ms = rr->config.target_latency_ms / (rr->queue.length + 1);
+        if (share_ms < quantum_ms) quantum_ms = share_ms;
+        if (quantum_ms < RR_MIN_QUANTUM_MS) quantum_ms = RR_MIN_QUANTUM_MS;
+    }
+    quantum_ms = (quantum_ms + TICKS_MS - 1) / TICKS_MS * TICKS_MS;
+    return (quantum_ms > 0) ? quantum_ms : TICKS_MS;
+}
 
+/**
+ * @brief Give the running pcb a new slice, starting now
+ */
+static void start_slice(rr_t *rr, pcb_t *task, uint32_t current_time_ms) {
+    task->slice_start_ms = current_time_ms;
+    rr->slice_ms = rr_quantum(rr);
+    rr->slices++;
+}
 
+void rr_scheduler(uint32_t current_time_ms, rr_t *rr, pcb_t **cpu_task) {
     if (*cpu_task) {
-        (*cpu_task)->ellapsed_time_ms += TICKS_MS;
+        pcb_t *task = *cpu_task;
         /*
-             *Se a CPU está ocupada (*cpu_task não é NULL):
-             *Incrementa o tempo que o processo já executou (ellapsed_time_ms) em cada “tick” do simulador.
-             *
-        */
+         *Se a CPU está ocupada (*cpu_task não é NULL):
+         *Incrementa o tempo que o processo já executou (ellapsed_time_ms) em cada “tick” do simulador.
+         */
+        task->ellapsed_time_ms += TICKS_MS;
+        rr->slice_run_ms += TICKS_MS;
 
-        if ((*cpu_task)->ellapsed_time_ms >= (*cpu_task)->time_ms) {
+        if (task->ellapsed_time_ms >= task->time_ms) {
             /*
-                *Verifica se o processo já terminou:
-                *time_ms é o tempo total que o processo precisa para completar.
-                *Se ellapsed_time_ms >= time_ms, o processo terminou.
-                *
-            */
-            // Task finished
-            // Send msg to application
-            msg_t msg = {
-                .pid = (*cpu_task)->pid,
-                .request = PROCESS_REQUEST_DONE,
-                .time_ms = current_time_ms
-            };
-            /*
-                 *Envia uma mensagem para informar que o processo terminou.
-                 *msg contém: PID, tipo de requisição (PROCESS_REQUEST_DONE) e tempo atual.
-                 *write envia a mensagem via socket para o processo/aplicação.
-                 *
+             *O processo terminou (ellapsed_time_ms >= time_ms): a simulação envia DONE à aplicação.
+             *O PCB continua associado ao socket da aplicação, à espera do próximo pedido,
+             *e a CPU fica livre (cpu_task = NULL).
              */
-            if (write((*cpu_task)->sockfd, &msg, sizeof(msg_t)) != sizeof(msg_t)) {
-                perror("write");
-            }
-            // Application finished and can be removed (this is FIFO after all)
+            task->status = TASK_COMMAND;
+            *cpu_task = NULL;
+        } else if (current_time_ms - task->slice_start_ms >= rr->slice_ms) {
             /*
-                 *Libera a memória do processo terminado.
-                 *CPU fica livre (cpu_task = NULL).
+             *O processo não terminou, mas já usou todo o seu slice, contado desde o dispatch.
+             *Se há processos à espera, volta para o fim da fila de prontos e a CPU fica livre
+             *para o próximo; senão continua a correr com um slice novo.
              */
-            free(*cpu_task);
-            *cpu_task = NULL;
-        }
-
-        /*
-         *Se o processo não terminou, mas já usou
-         todo o seu time slice (TIME_SLICE_MS), ele é preemptado.
-         *enqueue_pcb(rq, *cpu_task) coloca o processo no final da fila de prontos,
-         garantindo que todos os processos tenham chance de rodar.
-         *CPU fica livre (*cpu_task = NULL) para pegar o próximo processo da fila.
-         */
-        else if ((*cpu_task)->ellapsed_time_ms % TIME_SLICE_MS == 0) {
-            // reinserir no final da fila
-            enqueue_pcb(rq, *cpu_task);
-            *cpu_task = NULL;
+            if (rr->queue.length > 0) {
+                enqueue_pcb(&rr->queue, task);
+                *cpu_task = NULL;
+            } else {
+                rr->renewals++;
+                start_slice(rr, task, current_time_ms);
+            }
         }
     }
     /*
      *Se a CPU está livre e há processos na fila de prontos,
-     remove o próximo processo da fila (dequeue_pcb) e o coloca na CPU.
-     *Mantém a ordem FIFO dentro da fila,
-     garantindo que processos antigos não fiquem “presos”.
-
+     *remove o próximo processo da fila (ordem FIFO) e o coloca na CPU, com um slice novo.
      */
-    if (*cpu_task == NULL && rq->head != NULL) {
-        *cpu_task = dequeue_pcb(rq);
+    if (*cpu_task == NULL && rr->queue.head != NULL) {
+        *cpu_task = dequeue_pcb(&rr->queue);
+        start_slice(rr, *cpu_task, current_time_ms);
     }
-}
\ No newline at end of file
+}
+
+uint32_t rr_ticks_to_next_event(const rr_t *rr, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    // The slice ends in the tick at slice_start_ms + slice_ms
+    uint32_t end_ms = cpu_task->slice_start_ms + rr->slice_ms;
+    return (end_ms >= current_time_ms) ? (end_ms - current_time_ms) / TICKS_MS + 1 : 1;
+}
+
+static int rr_rq_init(void *rq, uint32_t capacity, const scheduler_config_t *config) {
+    rr_init(rq, config ? &config->rr : NULL);
+    return 0;
+}
+
+static int rr_rq_enqueue(void *rq, pcb_t *pcb) {
+    return enqueue_pcb(&((rr_t *) rq)->queue, pcb);
+}
+
+static pcb_t *rr_rq_pick_next(void *rq) {
+    return dequeue_pcb(&((rr_t *) rq)->queue);
+}
+
+static pcb_t *rr_rq_remove(void *rq, pcb_t *pcb) {
+    queue_t *queue = &((rr_t *) rq)->queue;
+    return (pcb->queue == queue) ? remove_pcb(queue, pcb) : NULL;
+}
+
+static uint32_t rr_rq_length(const void *rq) {
+    return ((const rr_t *) rq)->queue.length;
+}
+
+static void rr_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    rr_scheduler(current_time_ms, rq, cpu_task);
+}
+
+static uint32_t rr_ticks_to_event(const void *rq, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    return rr_ticks_to_next_event(rq, cpu_task, current_time_ms);
+}
+
+static void rr_skip(void *rq, pcb_t *cpu_task, uint32_t skipped_ms) {
+    ((rr_t *) rq)->slice_run_ms += skipped_ms;
+}
+
+static void rr_print_stats(const void *rq) {
+    const rr_t *rr = rq;
+    printf("  RR: %llu slices of %.1f ms on average, %llu renewed\n", (unsigned long long) rr->slices,
+           rr->slices > 0 ? (double) rr->slice_run_ms / rr->slices : 0.0, (unsigned long long) rr->renewals);
+}
+
+const scheduler_t RR_SCHEDULER = {
+    .name = "RR",
+    .rq_size = sizeof(rr_t),
+    .init = rr_rq_init,
+    .enqueue = rr_rq_enqueue,
+    .pick_next = rr_rq_pick_next,
+    .remove = rr_rq_remove,
+    .length = rr_rq_length,
+    .tick = rr_tick,
+    .ticks_to_event = rr_ticks_to_event,
+    .skip = rr_skip,
+    .print_stats = rr_print_stats,
+};
@@ -7,11 +7,58 @@
 #include <stdint.h>
 #include "queue.h"   // Para pcb_t e queue_t
 
+#define RR_DEFAULT_QUANTUM_MS 500   // Time slice, and the longest one with a dynamic quantum
+#define RR_MIN_QUANTUM_MS 20        // Shortest slice of a dynamic quantum
+
+typedef struct {
+    uint32_t quantum_ms;            // Fixed time slice
+    uint32_t target_latency_ms;     // 0 for a fixed quantum, otherwise the time in which every waiting pcb should run once
+} rr_config_t;
+
+// The RR ready queue: the pcbs in arrival order, and the slice of the running one
+typedef struct {
+    queue_t queue;
+    rr_config_t config;
+    uint32_t slice_ms;              // Length of the slice of the running pcb
+    uint64_t slices;                // Number of slices given, including the renewed ones
+    uint64_t renewals;              // Slices that ended with nobody waiting, so the pcb kept the CPU
+    uint64_t slice_run_ms;          // Time the slices actually ran, up to their end, block or exit
+} rr_t;
+
+/**
+ * @brief Fill a configuration with the default values
+ */
+void rr_config_default(rr_config_t *config);
+
+/**
+ * @brief Initialize an empty RR ready queue
+ *
+ * @param config The configuration, or NULL for the defaults
+ */
+void rr_init(rr_t *rr, const rr_config_t *config);
+
+/**
+ * @brief Length of the next slice
+ *
+ * The fixed quantum, or with a target latency, the latency shared by the pcbs waiting and the
+ * one that gets the slice, between RR_MIN_QUANTUM_MS and the quantum, in whole ticks.
+ */
+uint32_t rr_quantum(const rr_t *rr);
+
 /**
  * @brief Round-Robin (RR) scheduling algorithm
  *
- * Executa cada processo por um time slice fixo de 500ms.
+ * Executa cada processo por um time slice (quantum) contado a partir do seu dispatch
+ * (slice_start_ms). No fim do slice, se há processos à espera, o processo volta para o fim
+ * da fila; senão continua na CPU com um slice novo.
+ *
+ */
+void rr_scheduler(uint32_t current_time_ms, rr_t *rr, pcb_t **cpu_task);
+
+/**
+ * @brief Number of ticks until the running pcb reaches the end of its time slice, at least 1
  *
+ * @param current_time_ms The time of the next tick
  */
-void rr_scheduler(uint32_t current_time_ms, queue_t *rq, pcb_t **cpu_task);
+uint32_t rr_ticks_to_next_event(const rr_t *rr, const pcb_t *cpu_task, uint32_t current_time_ms);
 #endif //RR_H
@@ -0,0 +1,210 @@
+#include "scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Adding a policy: implement scheduler_t (policy.h) and list it here
+const scheduler_t *const SCHEDULERS[] = {
+    &FIFO_SCHEDULER,
+    &SJF_SCHEDULER,
+    &RR_SCHEDULER,
+    &MLFQ_SCHEDULER,
+    &SRTF_SCHEDULER,
+    &STRIDE_SCHEDULER,
+    &LOTTERY_SCHEDULER,
+    &CFS_SCHEDULER,
+    NULL
+};
+
+#define RQ_ALIGN 64     // Every ready queue starts on its own cache line
+
+const scheduler_t *get_scheduler(const char *name) {
+    for (int i = 0; SCHEDULERS[i] != NULL; i++) {
+        if (strcmp(name, SCHEDULERS[i]->name) == 0) {
+            return SCHEDULERS[i];
+        }
+    }
+    printf("Scheduler %s not recognized. Available options are:\n", name);
+    for (int i = 0; SCHEDULERS[i] != NULL; i++) {
+        printf(" - %s\n", SCHEDULERS[i]->name);
+    }
+    return NULL;
+}
+
+void scheduler_config_default(scheduler_config_t *config) {
+    rr_config_default(&config->rr);
+    mlfq_config_default(&config->mlfq);
+    cfs_config_default(&config->cfs);
+}
+
+int scheduler_config_parse_option(scheduler_config_t *config, memory_config_t *memory, int opt, const char *arg) {
+    switch (opt) {
+        case 'q':
+            config->rr.quantum_ms = (uint32_t) strtoul(arg, NULL, 10);
+            if (config->rr.quantum_ms == 0) {
+                fprintf(stderr, "The RR quantum must be at least 1 ms\n");
+                return -1;
+            }
+            return 1;
+        case 'r':
+            config->rr.target_latency_ms = (uint32_t) strtoul(arg, NULL, 10);
+            return 1;
+        case 'L':
+            if (mlfq_config_set_levels(&config->mlfq, (uint32_t) strtoul(arg, NULL, 10)) < 0) {
+                fprintf(stderr, "The number of MLFQ levels must be between 1 and %d\n", MLFQ_MAX_LEVELS);
+                return -1;
+            }
+            return 1;
+        case 'Q':
+            if (mlfq_config_parse_quanta(&config->mlfq, arg) < 0) {
+                fprintf(stderr, "Invalid MLFQ quanta: %s\n", arg);
+                return -1;
+            }
+            return 1;
+        case 'B':
+            config->mlfq.boost_interval_ms = (uint32_t) strtoul(arg, NULL, 10);
+            return 1;
+        case 'l':
+            config->cfs.target_latency_ms = (uint32_t) strtoul(arg, NULL, 10);
+            return 1;
+        case 'g':
+            config->cfs.min_granularity_ms = (uint32_t) strtoul(arg, NULL, 10);
+            if (config->cfs.min_granularity_ms == 0) {
+                fprintf(stderr, "The CFS granularity must be at least 1 ms\n");
+                return -1;
+            }
+            return 1;
+        case 'f':
+            memory->frames = (uint32_t) strtoul(arg, NULL, 10);
+            return 1;
+        case 'F':
+            memory->fault_ms = (uint32_t) strtoul(arg, NULL, 10);
+            return 1;
+        case 'R':
+            memory->replacement = get_replacement(arg);
+            if (!memory->replacement) {
+                fprintf(stderr, "Unknown page replacement %s, available:", arg);
+                for (int i = 0; REPLACEMENTS[i] != NULL; i++) fprintf(stderr, " %s", REPLACEMENTS[i]->name);
+                fprintf(stderr, "\n");
+                return -1;
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int machine_init(machine_t *machine, const scheduler_t *scheduler, uint32_t n_cores, uint32_t capacity,
+                 const scheduler_config_t *config) {
+    scheduler_config_t defaults;
+    if (!config) {
+        scheduler_config_default(&defaults);
+        config = &defaults;
+    }
+    size_t stride = (scheduler->rq_size + RQ_ALIGN - 1) / RQ_ALIGN * RQ_ALIGN;
+    *machine = (machine_t) {.scheduler = scheduler};
+    machine->cores = calloc(n_cores, sizeof(cpu_core_t));
+    machine->rq_block = aligned_alloc(RQ_ALIGN, stride * n_cores);
+    if (!machine->cores || !machine->rq_block) {
+        machine_destroy(machine);
+        return -1;
+    }
+    for (uint32_t i = 0; i < n_cores; i++) {
+        machine->cores[i].rq = (char *) machine->rq_block + i * stride;
+        if (scheduler->init(machine->cores[i].rq, capacity, config) < 0) {
+            machine_destroy(machine);
+            return -1;
+        }
+        machine->n_cores = i + 1;
+    }
+    return 0;
+}
+
+void machine_destroy(machine_t *machine) {
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        if (machine->scheduler->destroy) machine->scheduler->destroy(machine->cores[i].rq);
+    }
+    free(machine->cores);
+    free(machine->rq_block);
+    machine->cores = NULL;
+    machine->rq_block = NULL;
+    machine->n_cores = 0;
+}
+
+void machine_enqueue(machine_t *machine, pcb_t *pcb) {
+    const scheduler_t *scheduler = machine->scheduler;
+    cpu_core_t *target = &machine->cores[0];
+    uint32_t target_load = UINT32_MAX;
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        cpu_core_t *core = &machine->cores[i];
+        uint32_t load = scheduler->length(core->rq) + (core->task ? 1 : 0);
+        if (load < target_load) {
+            target = core;
+            target_load = load;
+        }
+    }
+    if (!scheduler->enqueue(target->rq, pcb)) {
+        printf("Failed to enqueue process %d\n", pcb->pid);
+    }
+}
+
+pcb_t *machine_remove(machine_t *machine, pcb_t *pcb) {
+    const scheduler_t *scheduler = machine->scheduler;
+    pcb_t *removed = NULL;
+    for (uint32_t i = 0; i < machine->n_cores && !removed; i++) {
+        cpu_core_t *core = &machine->cores[i];
+        if (core->task == pcb) {
+            core->task = NULL;
+            removed = pcb;
+        } else {
+            removed = scheduler->remove(core->rq, pcb);
+        }
+    }
+    if (scheduler->on_exit) scheduler->on_exit(pcb);
+    return removed;
+}
+
+void machine_block(machine_t *machine, blocked_queue_t *blocked_queue, pcb_t *pcb, uint32_t current_time_ms) {
+    if (machine->scheduler->on_block) machine->scheduler->on_block(pcb, current_time_ms);
+    block_pcb(blocked_queue, pcb, current_time_ms);
+}
+
+void machine_print_stats(const machine_t *machine, uint32_t elapsed_ms) {
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        const cpu_core_t *core = &machine->cores[i];
+        printf("CPU %u: utilisation %.1f%%, %u context switches, %u preemptions, %u steals\n", i,
+               elapsed_ms > 0 ? 100.0 * (double) core->busy_ms / elapsed_ms : 0.0, core->dispatches,
+               core->preemptions, core->steals);
+        if (machine->scheduler->print_stats) machine->scheduler->print_stats(core->rq);
+    }
+}
+
+int blocked_queue_init(blocked_queue_t *blocked_queue, uint32_t capacity) {
+    blocked_queue->next_check_ms = 0;
+    return heap_init(&blocked_queue->heap, capacity);
+}
+
+void blocked_queue_destroy(blocked_queue_t *blocked_queue) {
+    heap_destroy(&blocked_queue->heap);
+}
+
+void block_pcb(blocked_queue_t *blocked_queue, pcb_t *pcb, uint32_t current_time_ms) {
+    // The first check counts the first tick of the block
+    uint32_t first_check_ms = (blocked_queue->next_check_ms > current_time_ms) ?
+        blocked_queue->next_check_ms : current_time_ms;
+    uint32_t block_ticks = (pcb->time_ms + TICKS_MS - 1) / TICKS_MS;
+    uint32_t wakeup_ms = first_check_ms + (block_ticks > 0 ? block_ticks - 1 : 0) * TICKS_MS;
+    heap_push(&blocked_queue->heap, pcb, wakeup_ms);
+}
+
+pcb_t *unblock_pcb(blocked_queue_t *blocked_queue, pcb_t *pcb) {
+    return heap_remove(&blocked_queue->heap, pcb);
+}
+
+int next_wakeup(const blocked_queue_t *blocked_queue, uint32_t *wakeup_ms) {
+    uint64_t key;
+    if (!heap_peek(&blocked_queue->heap, &key)) return 0;
+    *wakeup_ms = (uint32_t) key;
+    return 1;
+}
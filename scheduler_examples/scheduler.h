@@ -0,0 +1,146 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#include "heap.h"
+#include "policy.h"
+#include "queue.h"
+
+/*
+ * Simulation pieces shared by the socket based simulator (ossim.c) and the
+ * in-process trace driven simulators (simbench.c, simsweep.c): the registry of
+ * scheduling policies, the simulated machine and the blocked queue. The policies
+ * themselves implement scheduler_t (policy.h), and a simulation that drives all of
+ * it tick by tick is a sim_t (sim.h).
+ */
+
+// The BLOCKED queue: a min-heap of the blocked pcbs, keyed by the absolute time their block ends
+typedef struct {
+    pcb_heap_t heap;
+    uint32_t next_check_ms;         // Time of the next check_blocked_queue()
+} blocked_queue_t;
+
+// A simulated core: its own ready queue and running slot
+typedef struct {
+    pcb_t *task;                    // The pcb running on the core, NULL when idle
+    void *rq;                       // Ready queue, private to the scheduler
+    uint64_t busy_ms;               // Time spent running pcbs
+    uint32_t steals;                // Number of pcbs stolen from other cores
+    uint32_t dispatches;            // Number of times the core switched to another pcb
+    uint32_t preemptions;           // Number of pcbs put back in the ready queue before their burst ended
+} cpu_core_t;
+
+// The simulated machine
+typedef struct {
+    const scheduler_t *scheduler;   // Policy of every core
+    cpu_core_t *cores;
+    uint32_t n_cores;
+    void *rq_block;                 // Ready queues of all the cores, one after the other
+} machine_t;
+
+// The registry of the policies, terminated by NULL
+extern const scheduler_t *const SCHEDULERS[];
+
+/**
+ * @brief Look up a scheduler by name
+ *
+ * Prints the available options if the name is not recognized.
+ *
+ * @param name The name of the scheduler (e.g. "FIFO")
+ * @return The scheduler, or NULL if the name is not recognized
+ */
+const scheduler_t *get_scheduler(const char *name);
+
+/**
+ * @brief Initialize a machine with idle cores and empty ready queues
+ *
+ * @param machine The machine
+ * @param scheduler The policy of the cores
+ * @param n_cores The number of cores
+ * @param capacity The expected number of pcbs, to size the ready queues
+ * @param config The tunables of the policies, or NULL for the defaults
+ * @return 0 on success, -1 on failure
+ */
+int machine_init(machine_t *machine, const scheduler_t *scheduler, uint32_t n_cores, uint32_t capacity,
+                 const scheduler_config_t *config);
+
+/**
+ * @brief Release the memory of a machine (the pcbs are not freed)
+ */
+void machine_destroy(machine_t *machine);
+
+/**
+ * @brief Add a pcb that requested to RUN to the least loaded core
+ *
+ * The load of a core is the number of pcbs in its ready queue plus the one it runs.
+ */
+void machine_enqueue(machine_t *machine, pcb_t *pcb);
+
+/**
+ * @brief Take a pcb out of the core that runs it or of the ready queue that holds it
+ *
+ * The scheduler is told the pcb leaves the simulation.
+ *
+ * @return The pcb, or NULL if no core held it
+ */
+pcb_t *machine_remove(machine_t *machine, pcb_t *pcb);
+
+/**
+ * @brief Put a pcb that requested to BLOCK for pcb->time_ms in the blocked queue
+ *
+ * Tells the scheduler, then calls block_pcb().
+ */
+void machine_block(machine_t *machine, blocked_queue_t *blocked_queue, pcb_t *pcb, uint32_t current_time_ms);
+
+/**
+ * @brief Print the utilisation of every core, and the statistics of its ready queue
+ *
+ * @param machine The machine
+ * @param elapsed_ms The simulated time the utilisation is relative to
+ */
+void machine_print_stats(const machine_t *machine, uint32_t elapsed_ms);
+
+/**
+ * @brief Initialize an empty blocked queue
+ *
+ * @param blocked_queue The blocked queue
+ * @param capacity The expected number of pcbs, to size the heap
+ * @return 0 on success, -1 on failure
+ */
+int blocked_queue_init(blocked_queue_t *blocked_queue, uint32_t capacity);
+
+/**
+ * @brief Release the memory of a blocked queue (the pcbs are not freed)
+ */
+void blocked_queue_destroy(blocked_queue_t *blocked_queue);
+
+/**
+ * @brief Add a pcb that requested to BLOCK for pcb->time_ms to the blocked queue
+ *
+ * The block ends in the check_blocked_queue() that would have counted pcb->time_ms down to
+ * zero, one tick at a time, starting with the next check.
+ *
+ * @param blocked_queue The blocked queue
+ * @param pcb The pcb
+ * @param current_time_ms The current time in milliseconds
+ */
+void block_pcb(blocked_queue_t *blocked_queue, pcb_t *pcb, uint32_t current_time_ms);
+
+/**
+ * @brief Take a pcb out of the blocked queue
+ *
+ * @return The pcb, or NULL if it was not in the blocked queue
+ */
+pcb_t *unblock_pcb(blocked_queue_t *blocked_queue, pcb_t *pcb);
+
+/**
+ * @brief Time at which the next block ends
+ *
+ * @param blocked_queue The blocked queue
+ * @param wakeup_ms Receives the time of the earliest wake-up
+ * @return 1 if a pcb is blocked, 0 if the blocked queue is empty
+ */
+int next_wakeup(const blocked_queue_t *blocked_queue, uint32_t *wakeup_ms);
+
+#endif //SCHEDULER_H
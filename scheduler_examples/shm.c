@@ -0,0 +1,90 @@
+#define _GNU_SOURCE
+#include "shm.h"
+
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+shm_channel_t *shm_channel_create(int fds[SHM_FD_COUNT]) {
+    int memfd = memfd_create("ossim-channel", MFD_CLOEXEC);
+    if (memfd < 0) return NULL;
+    if (ftruncate(memfd, sizeof(shm_channel_t)) < 0) {
+        close(memfd);
+        return NULL;
+    }
+    shm_channel_t *channel = mmap(NULL, sizeof(shm_channel_t), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (channel == MAP_FAILED) {
+        close(memfd);
+        return NULL;
+    }
+    // The memfd is zero filled, so are the ring indexes
+    channel->magic = SHM_MAGIC;
+    channel->size = sizeof(shm_channel_t);
+    fds[SHM_FD_MEMORY] = memfd;
+    fds[SHM_FD_REQUESTS] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    fds[SHM_FD_REPLIES] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fds[SHM_FD_REQUESTS] < 0 || fds[SHM_FD_REPLIES] < 0) {
+        int saved_errno = errno;
+        for (int i = 0; i < SHM_FD_COUNT; i++) {
+            if (fds[i] >= 0) close(fds[i]);
+        }
+        munmap(channel, sizeof(shm_channel_t));
+        errno = saved_errno;
+        return NULL;
+    }
+    return channel;
+}
+
+shm_channel_t *shm_channel_map(int memfd) {
+    struct stat st;
+    if (fstat(memfd, &st) < 0 || (size_t) st.st_size != sizeof(shm_channel_t)) return NULL;
+    shm_channel_t *channel = mmap(NULL, sizeof(shm_channel_t), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (channel == MAP_FAILED) return NULL;
+    if (channel->magic != SHM_MAGIC || channel->size != sizeof(shm_channel_t)) {
+        munmap(channel, sizeof(shm_channel_t));
+        return NULL;
+    }
+    return channel;
+}
+
+void shm_channel_unmap(shm_channel_t *channel) {
+    munmap(channel, sizeof(shm_channel_t));
+}
+
+uint32_t shm_ring_push(shm_ring_t *ring, const msg_t *msgs, uint32_t count, int *wake) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t free_slots = SHM_RING_CAPACITY - (tail - head);
+    if (count > free_slots) count = free_slots;
+    for (uint32_t i = 0; i < count; i++) {
+        ring->slots[(tail + i) & (SHM_RING_CAPACITY - 1)] = msgs[i];
+    }
+    *wake = 0;
+    if (count == 0) return 0;
+    // Both the publication of the tail and the consumer's update of the head are sequentially
+    // consistent: if the consumer missed these messages, it had moved the head up to our old tail
+    // before looking, and we see that here
+    atomic_store(&ring->tail, tail + count);
+    *wake = (atomic_load(&ring->head) == tail);
+    return count;
+}
+
+uint32_t shm_ring_pop(shm_ring_t *ring, msg_t *msgs, uint32_t max) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load(&ring->tail);
+    uint32_t count = tail - head;
+    if (count > max) count = max;
+    for (uint32_t i = 0; i < count; i++) {
+        msgs[i] = ring->slots[(head + i) & (SHM_RING_CAPACITY - 1)];
+    }
+    if (count > 0) {
+        atomic_store(&ring->head, head + count);
+    }
+    return count;
+}
+
+uint32_t shm_ring_length(shm_ring_t *ring) {
+    return atomic_load(&ring->tail) - atomic_load_explicit(&ring->head, memory_order_relaxed);
+}
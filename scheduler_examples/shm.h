@@ -0,0 +1,87 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "msg.h"
+
+/*
+ * Shared-memory transport, an alternative to the socket for the messages of an application.
+ * The application creates a shm_channel_t in a memfd and hands it to the scheduler with its
+ * HELLO (SCM_RIGHTS), together with two eventfds, one to wake up each side. Each direction
+ * is a single-producer single-consumer ring of msg_t: the producer only moves the tail and
+ * the consumer only moves the head, so no lock is needed. The producer only signals the
+ * eventfd when the consumer had emptied the ring, i.e. when it may be waiting.
+ */
+
+#define SHM_RING_CAPACITY 64        // Messages per ring, a power of two
+#define SHM_MAGIC 0x4f53484du       // "OSHM"
+
+// Descriptors sent with the HELLO, in this order
+#define SHM_FD_MEMORY 0             // memfd with the shm_channel_t
+#define SHM_FD_REQUESTS 1           // eventfd signalled by the application
+#define SHM_FD_REPLIES 2            // eventfd signalled by the scheduler
+#define SHM_FD_COUNT 3
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t head;     // Next message to consume, moved by the consumer
+    _Alignas(64) _Atomic uint32_t tail;     // Next free slot, moved by the producer
+    _Alignas(64) msg_t slots[SHM_RING_CAPACITY];
+} shm_ring_t;
+
+typedef struct shm_channel_st {
+    uint32_t magic;                 // SHM_MAGIC
+    uint32_t size;                  // sizeof(shm_channel_t)
+    shm_ring_t requests;            // From the application to the scheduler
+    shm_ring_t replies;             // From the scheduler to the application
+} shm_channel_t;
+
+/**
+ * @brief Create a channel for an application
+ *
+ * @param fds Set to the descriptors to send with the HELLO (see SHM_FD_*)
+ * @return The mapped channel, or NULL on failure (errno is set)
+ */
+shm_channel_t *shm_channel_create(int fds[SHM_FD_COUNT]);
+
+/**
+ * @brief Map the channel received from an application
+ *
+ * @param memfd The memfd of the channel, it can be closed afterwards
+ * @return The mapped channel, or NULL if it is not a valid channel
+ */
+shm_channel_t *shm_channel_map(int memfd);
+
+/**
+ * @brief Unmap a channel
+ */
+void shm_channel_unmap(shm_channel_t *channel);
+
+/**
+ * @brief Append messages to a ring, from its producer
+ *
+ * @param ring The ring
+ * @param msgs The messages
+ * @param count The number of messages
+ * @param wake Set to 1 if the consumer has to be woken up, 0 otherwise
+ * @return The number of messages appended, less than count if the ring is full
+ */
+uint32_t shm_ring_push(shm_ring_t *ring, const msg_t *msgs, uint32_t count, int *wake);
+
+/**
+ * @brief Take messages from a ring, from its consumer
+ *
+ * @param ring The ring
+ * @param msgs Receives the messages
+ * @param max The maximum number of messages to take
+ * @return The number of messages taken, 0 if the ring is empty
+ */
+uint32_t shm_ring_pop(shm_ring_t *ring, msg_t *msgs, uint32_t max);
+
+/**
+ * @brief Number of messages in a ring, as seen from its consumer
+ */
+uint32_t shm_ring_length(shm_ring_t *ring);
+
+#endif //SHM_H
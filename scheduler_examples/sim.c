@@ -0,0 +1,272 @@
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "msg.h"
+#include "profile.h"
+#include "trace.h"
+
+int sim_init(sim_t *sim, const scheduler_t *scheduler, uint32_t n_cores, uint32_t capacity,
+             const scheduler_config_t *config, const memory_config_t *memory,
+             pcb_notifier_t notifier, void *notifier_context) {
+    if (!notifier) return -1;
+    *sim = (sim_t) {
+        .notifier = notifier,
+        .notifier_context = notifier_context
+    };
+    metrics_init(&sim->metrics);
+    if (pool_init(&sim->pcb_pool, sizeof(pcb_t), capacity) < 0) return -1;
+    if (machine_init(&sim->machine, scheduler, n_cores, capacity, config) < 0) {
+        pool_destroy(&sim->pcb_pool);
+        return -1;
+    }
+    if (blocked_queue_init(&sim->blocked_queue, capacity) < 0) {
+        machine_destroy(&sim->machine);
+        pool_destroy(&sim->pcb_pool);
+        return -1;
+    }
+    if (memory_init(&sim->memory, memory) < 0) {
+        blocked_queue_destroy(&sim->blocked_queue);
+        machine_destroy(&sim->machine);
+        pool_destroy(&sim->pcb_pool);
+        return -1;
+    }
+    return 0;
+}
+
+void sim_destroy(sim_t *sim) {
+    machine_destroy(&sim->machine);
+    blocked_queue_destroy(&sim->blocked_queue);
+    memory_destroy(&sim->memory);
+    pool_destroy(&sim->pcb_pool);
+    metrics_destroy(&sim->metrics);
+}
+
+/**
+ * @brief Send a message to the application of a pcb
+ */
+static void notify(sim_t *sim, pcb_t *pcb, process_request_t request) {
+    sim->notifier(sim->notifier_context, pcb, request, sim->current_time_ms);
+}
+
+/**
+ * @brief Send the DONE of a burst or a block, the application answers with its next command
+ */
+static void send_done(sim_t *sim, pcb_t *pcb) {
+    sim->awaiting_commands++;
+    notify(sim, pcb, PROCESS_REQUEST_DONE);
+}
+
+pcb_t *sim_arrive(sim_t *sim, uint32_t sockfd) {
+    // New PCBs do not have a time yet, will be set when we receive a RUN message
+    pcb_t *pcb = new_pcb(&sim->pcb_pool, sim->last_pid + 1, sockfd, 0);
+    if (!pcb) return NULL;
+    sim->last_pid++;
+    metrics_arrival(pcb, sim->current_time_ms);
+    sim->awaiting_commands++;
+    return pcb;
+}
+
+void sim_leave(sim_t *sim, pcb_t *pcb) {
+    if (pcb->status == TASK_COMMAND) {
+        sim->awaiting_commands--;
+    } else if (pcb->status == TASK_BLOCKED) {
+        unblock_pcb(&sim->blocked_queue, pcb);
+    } else {
+        machine_remove(&sim->machine, pcb);
+    }
+    if (pcb->metered && metrics_record(&sim->metrics, pcb) < 0) {
+        perror("metrics_record");
+    }
+    memory_release(&sim->memory, pcb);
+    free_pcb(&sim->pcb_pool, pcb);
+}
+
+/**
+ * @brief Acknowledge the request of an application, it now waits for the DONE
+ */
+static void acknowledge(sim_t *sim, pcb_t *pcb) {
+    sim->awaiting_commands--;
+    notify(sim, pcb, PROCESS_REQUEST_ACK);
+    trace_event(TRACE_ACK, pcb, TRACE_NO_CPU, sim->current_time_ms);
+    DBG("Send ACK message to process %d with time %d\n", pcb->pid, sim->current_time_ms);
+}
+
+void sim_request_run(sim_t *sim, pcb_t *pcb, uint32_t time_ms, int32_t nice, const uint32_t *pages,
+                     uint32_t n_pages) {
+    pcb->time_ms = time_ms;
+    pcb->nice = nice;
+    pcb->pages = pages;
+    pcb->n_pages = n_pages;
+    pcb->ellapsed_time_ms = 0;
+    pcb->status = TASK_RUNNING;
+    metrics_ready(pcb, sim->current_time_ms);
+    trace_event(TRACE_RUN, pcb, TRACE_NO_CPU, sim->current_time_ms);
+    machine_enqueue(&sim->machine, pcb);
+    DBG("Process %d requested RUN for %d ms\n", pcb->pid, pcb->time_ms);
+    acknowledge(sim, pcb);
+}
+
+void sim_request_block(sim_t *sim, pcb_t *pcb, uint32_t time_ms) {
+    pcb->time_ms = time_ms;
+    pcb->status = TASK_BLOCKED;
+    metrics_blocked(pcb, sim->current_time_ms);
+    trace_event(TRACE_BLOCK, pcb, TRACE_NO_CPU, sim->current_time_ms);
+    machine_block(&sim->machine, &sim->blocked_queue, pcb, sim->current_time_ms);
+    DBG("Process %d requested BLOCK for %d ms\n", pcb->pid, pcb->time_ms);
+    acknowledge(sim, pcb);
+}
+
+/**
+ * @brief Account the transitions of a core, seen by comparing the pcb it ran before and after the scheduler
+ */
+static void core_switched(sim_t *sim, cpu_core_t *core, uint16_t cpu, pcb_t *previous) {
+    uint32_t current_time_ms = sim->current_time_ms;
+    if (core->task == previous) return;
+    if (previous) {
+        if (previous->status == TASK_RUNNING) {
+            // Preempted, back in a ready queue
+            core->preemptions++;
+            metrics_ready(previous, current_time_ms);
+            trace_event(TRACE_PREEMPT, previous, cpu, current_time_ms);
+        } else {
+            // Burst finished: the application will answer the DONE with its next command
+            metrics_burst_done(previous, current_time_ms);
+            trace_event(TRACE_DONE, previous, cpu, current_time_ms);
+            send_done(sim, previous);
+        }
+    }
+    if (core->task) {
+        core->dispatches++;
+        // The pages of a burst come back before it first runs, the faults lengthen it
+        memory_dispatch(&sim->memory, core->task);
+        metrics_dispatch(core->task, current_time_ms);
+        trace_event(TRACE_DISPATCH, core->task, cpu, current_time_ms);
+    }
+}
+
+void run_machine(sim_t *sim) {
+    machine_t *machine = &sim->machine;
+    const scheduler_t *scheduler = machine->scheduler;
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        cpu_core_t *core = &machine->cores[i];
+        pcb_t *previous = core->task;
+        if (previous) core->busy_ms += TICKS_MS;
+        PROFILE_BEGIN(PROFILE_SCHEDULER);
+        scheduler->tick(sim->current_time_ms, core->rq, &core->task);
+        PROFILE_END(PROFILE_SCHEDULER);
+        core_switched(sim, core, (uint16_t) i, previous);
+    }
+
+    // Work stealing: an idle core takes the next pcb of the core with the most pcbs waiting
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        cpu_core_t *core = &machine->cores[i];
+        if (core->task || scheduler->length(core->rq) > 0) continue;
+
+        cpu_core_t *victim = NULL;
+        uint32_t victim_length = 0;
+        for (uint32_t j = 0; j < machine->n_cores; j++) {
+            uint32_t length = scheduler->length(machine->cores[j].rq);
+            if (length > victim_length) {
+                victim = &machine->cores[j];
+                victim_length = length;
+            }
+        }
+        if (!victim) break;     // Nothing is waiting anywhere
+
+        pcb_t *pcb = scheduler->pick_next(victim->rq);
+        DBG("Core %u steals process %d\n", i, pcb->pid);
+        if (!scheduler->enqueue(core->rq, pcb)) {
+            scheduler->enqueue(victim->rq, pcb);    // Give it back
+            continue;
+        }
+        core->steals++;
+        // The core is idle, so the scheduler only dispatches the stolen pcb
+        scheduler->tick(sim->current_time_ms, core->rq, &core->task);
+        core_switched(sim, core, (uint16_t) i, NULL);
+    }
+}
+
+void check_blocked_queue(sim_t *sim) {
+    blocked_queue_t *blocked_queue = &sim->blocked_queue;
+    uint32_t current_time_ms = sim->current_time_ms;
+    // Only the pcbs whose block is over, earliest first
+    uint64_t wakeup_ms;
+    while (heap_peek(&blocked_queue->heap, &wakeup_ms) && wakeup_ms <= current_time_ms) {
+        pcb_t *pcb = heap_pop(&blocked_queue->heap);
+
+        // Send DONE message to the application
+        DBG("Process %d finished BLOCK, sending DONE\n", pcb->pid);
+        // The application will answer with its next command
+        pcb->status = TASK_COMMAND;
+        pcb->last_update_time_ms = current_time_ms;
+        metrics_unblocked(pcb, current_time_ms);
+        trace_event(TRACE_UNBLOCK, pcb, TRACE_NO_CPU, current_time_ms);
+        send_done(sim, pcb);
+    }
+    blocked_queue->next_check_ms = current_time_ms + TICKS_MS;
+}
+
+/**
+ * @brief Number of ticks until the pcb running on a core reaches an event, at least 1
+ */
+static uint32_t core_ticks_to_next_event(const scheduler_t *scheduler, const pcb_t *cpu, const void *rq,
+                                         uint32_t current_time_ms) {
+    uint32_t remaining_ms = (cpu->time_ms > cpu->ellapsed_time_ms) ? cpu->time_ms - cpu->ellapsed_time_ms : 0;
+    uint32_t cpu_ticks = (remaining_ms + TICKS_MS - 1) / TICKS_MS;
+    if (scheduler->ticks_to_event) {
+        uint32_t policy_ticks = scheduler->ticks_to_event(rq, cpu, current_time_ms);
+        if (policy_ticks < cpu_ticks) cpu_ticks = policy_ticks;
+    }
+    return (cpu_ticks > 0) ? cpu_ticks : 1;
+}
+
+uint32_t ticks_to_next_event(const sim_t *sim) {
+    const machine_t *machine = &sim->machine;
+    uint32_t current_time_ms = sim->current_time_ms;
+    uint32_t ticks = UINT32_MAX;
+    uint32_t waiting = 0;
+    uint32_t idle_cores = 0;
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        const cpu_core_t *core = &machine->cores[i];
+        uint32_t length = machine->scheduler->length(core->rq);
+        waiting += length;
+        if (core->task) {
+            uint32_t cpu_ticks = core_ticks_to_next_event(machine->scheduler, core->task, core->rq,
+                                                         current_time_ms);
+            if (cpu_ticks < ticks) ticks = cpu_ticks;
+        } else if (length > 0) {
+            return 1;       // Dispatch
+        } else {
+            idle_cores++;
+        }
+    }
+    if (idle_cores > 0 && waiting > 0) {
+        return 1;           // Steal
+    }
+    uint32_t wakeup_ms;
+    if (next_wakeup(&sim->blocked_queue, &wakeup_ms)) {
+        // The check of the first tick happens at current_time_ms
+        uint32_t block_ticks = (wakeup_ms > current_time_ms) ? (wakeup_ms - current_time_ms) / TICKS_MS + 1 : 1;
+        if (block_ticks < ticks) ticks = block_ticks;
+    }
+    if (ticks == UINT32_MAX) return 0;
+    return (ticks > 0) ? ticks : 1;
+}
+
+void fast_forward(sim_t *sim, uint32_t ticks) {
+    machine_t *machine = &sim->machine;
+    uint32_t skipped_ms = ticks * TICKS_MS;
+    for (uint32_t i = 0; i < machine->n_cores; i++) {
+        cpu_core_t *core = &machine->cores[i];
+        pcb_t *cpu = core->task;
+        if (cpu) {
+            cpu->ellapsed_time_ms += skipped_ms;
+            if (machine->scheduler->skip) machine->scheduler->skip(core->rq, cpu, skipped_ms);
+            core->busy_ms += skipped_ms;
+        }
+    }
+    sim->current_time_ms += skipped_ms;
+}
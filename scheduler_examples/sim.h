@@ -0,0 +1,131 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#include "memory.h"
+#include "metrics.h"
+#include "policy.h"
+#include "pool.h"
+#include "queue.h"
+#include "scheduler.h"
+
+/*
+ * The state of one simulation: the machine, the blocked queue, the memory, the pcbs, the
+ * metrics and the clock. A tick only touches what it reaches from its sim_t, and the messages to the
+ * applications go through the notifier of the simulation, so any number of simulations can
+ * live in the same process, each one driven by its own thread (see simsweep.c).
+ *
+ * The binary trace (trace.h) is the one piece of state that stays global: only a single
+ * simulation per process may record one.
+ */
+
+typedef struct sim_st {
+    machine_t machine;
+    blocked_queue_t blocked_queue;
+    memory_t memory;                // The frames, see memory.h
+    pool_t pcb_pool;                // The pcbs of the applications
+    metrics_t metrics;              // Metrics of the applications that left
+    uint32_t current_time_ms;
+    int32_t last_pid;               // Pid of the last pcb created by sim_arrive()
+    // Applications that received a DONE (or just arrived) and still have to tell what they
+    // want next. Virtual time cannot advance past them.
+    uint32_t awaiting_commands;
+    pcb_notifier_t notifier;        // Delivers the ACKs and DONEs to the applications
+    void *notifier_context;         // Handed to the notifier
+} sim_t;
+
+/**
+ * @brief Initialize a simulation at time 0 with idle cores and empty queues
+ *
+ * @param sim The simulation
+ * @param scheduler The policy of the cores
+ * @param n_cores The number of cores
+ * @param capacity The maximum number of applications at the same time
+ * @param config The tunables of the policies, or NULL for the defaults
+ * @param memory The frames and the page replacement, or NULL to leave paging off
+ * @param notifier Delivers the messages to the applications, required
+ * @param notifier_context Handed to the notifier
+ * @return 0 on success, -1 on failure or if there is no notifier
+ */
+int sim_init(sim_t *sim, const scheduler_t *scheduler, uint32_t n_cores, uint32_t capacity,
+             const scheduler_config_t *config, const memory_config_t *memory,
+             pcb_notifier_t notifier, void *notifier_context);
+
+/**
+ * @brief Release the memory of a simulation, including the pcbs still in it
+ */
+void sim_destroy(sim_t *sim);
+
+/**
+ * @brief Create the pcb of an application that arrives, with the next pid
+ *
+ * The application is waiting to send its first command.
+ *
+ * @param sockfd The socket of the application, 0 if it has none
+ * @return The pcb, or NULL if the pool is exhausted
+ */
+pcb_t *sim_arrive(sim_t *sim, uint32_t sockfd);
+
+/**
+ * @brief Take a pcb out of the simulation, wherever it is, keep its metrics and free it
+ */
+void sim_leave(sim_t *sim, pcb_t *pcb);
+
+/**
+ * @brief Handle the RUN request of an application waiting for commands, and acknowledge it
+ *
+ * @param time_ms The length of the burst
+ * @param nice The nice value of the burst
+ * @param pages The pages of the burst, which must stay valid until its DONE (see memory.h)
+ * @param n_pages The number of pages, 0 for none
+ */
+void sim_request_run(sim_t *sim, pcb_t *pcb, uint32_t time_ms, int32_t nice, const uint32_t *pages,
+                     uint32_t n_pages);
+
+/**
+ * @brief Handle the BLOCK request of an application waiting for commands, and acknowledge it
+ *
+ * @param time_ms The length of the block
+ */
+void sim_request_block(sim_t *sim, pcb_t *pcb, uint32_t time_ms);
+
+/**
+ * @brief Run one tick of the scheduler on every core
+ *
+ * After the schedulers ran, every idle core with an empty ready queue steals the next pcb
+ * of the core with the longest ready queue. The pcbs whose burst ended are sent a DONE.
+ */
+void run_machine(sim_t *sim);
+
+/**
+ * @brief Check the blocked queue for PCBs that finished their I/O.
+ *
+ * Only the pcbs whose block ends at or before the current time are touched, in O(log n)
+ * each. A DONE message is sent to their application and they are taken out of the
+ * blocked queue to wait for new commands.
+ */
+void check_blocked_queue(sim_t *sim);
+
+/**
+ * @brief Number of ticks until something observable happens in the simulation.
+ *
+ * Used in virtual time, once no application is waiting to send a command. An event is
+ * a burst completion on the CPU, whatever the scheduler acts on (scheduler_t.ticks_to_event:
+ * slice boundaries, demotions, preemptions), a block expiry, a dispatch from a ready queue
+ * or a steal, on any core. The current time is the time of the next tick.
+ *
+ * @return 1 when the next tick must be simulated normally, 0 when nothing is scheduled at all
+ */
+uint32_t ticks_to_next_event(const sim_t *sim);
+
+/**
+ * @brief Skip ticks in which nothing but time accounting would happen.
+ *
+ * Applies the accounting of the skipped ticks in one go, exactly as the schedulers would
+ * have done tick by tick, and moves the clock. The blocked pcbs wake up at absolute times,
+ * so they need none.
+ */
+void fast_forward(sim_t *sim, uint32_t ticks);
+
+#endif //SIM_H
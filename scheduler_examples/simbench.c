@@ -0,0 +1,144 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "metrics.h"
+#include "replay.h"
+#include "scheduler.h"
+#include "trace.h"
+
+/*
+ * Trace driven simulator: replays burst files in-process, without sockets (see replay.h).
+ *
+ * Run like: ./simbench [--scheduler <name>|all] [--copies N] <burst-file>...
+ */
+
+static double elapsed_s(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    const char *scheduler_name = "all";
+    uint32_t copies = 1;
+    uint32_t n_cpus = 1;
+    int summary = 0;
+    const char *trace_path = NULL;
+    uint64_t trace_capacity = TRACE_DEFAULT_CAPACITY;
+    scheduler_config_t config;
+    scheduler_config_default(&config);
+    memory_config_t memory;
+    memory_config_default(&memory);
+    static const struct option long_options[] = {
+        {"scheduler", required_argument, NULL, 's'},
+        {"copies", required_argument, NULL, 'n'},
+        {"cpus", required_argument, NULL, 'p'},
+        {"summary", no_argument, NULL, 'S'},
+        {"trace", required_argument, NULL, 't'},
+        {"trace-size", required_argument, NULL, 'T'},
+        SCHEDULER_CONFIG_LONG_OPTIONS,
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:n:p:St:T:" SCHEDULER_CONFIG_SHORT_OPTIONS, long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                scheduler_name = optarg;
+                break;
+            case 'n':
+                copies = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                n_cpus = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                summary = 1;
+                break;
+            case 't':
+                trace_path = optarg;
+                break;
+            case 'T':
+                trace_capacity = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                if (scheduler_config_parse_option(&config, &memory, opt, optarg) <= 0) exit(EXIT_FAILURE);
+                break;
+        }
+    }
+    if (optind >= argc || copies == 0 || n_cpus == 0) {
+        printf("Usage: %s [--scheduler <name>|all] [--copies N] [--cpus N] [--summary]\n"
+               "          [--trace FILE [--trace-size RECORDS]]\n"
+               SCHEDULER_CONFIG_USAGE
+               "          <burst-file>...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (trace_path && strcmp(scheduler_name, "all") == 0) {
+        fprintf(stderr, "--trace records a single scheduler, select it with --scheduler\n");
+        exit(EXIT_FAILURE);
+    }
+    if (trace_path && trace_open(trace_path, trace_capacity) < 0) {
+        perror(trace_path);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t n_traces = (uint32_t) (argc - optind);
+    trace_t *traces = calloc(n_traces, sizeof(trace_t));
+    if (!traces) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < n_traces; i++) {
+        if (load_trace(argv[optind + i], &traces[i]) < 0) {
+            return EXIT_FAILURE;
+        }
+    }
+    uint32_t n_apps = n_traces * copies;
+
+    printf("%-8s %10s %14s %16s %10s %10s %10s %12s\n", "Policy", "Apps", "Makespan (s)", "Turnaround (s)", "Util (%)",
+           "Switches", "Wall (s)", "Apps/s");
+    for (int s = 0; SCHEDULERS[s] != NULL; s++) {
+        const scheduler_t *scheduler = SCHEDULERS[s];
+        if (strcmp(scheduler_name, "all") != 0 && strcmp(scheduler_name, scheduler->name) != 0) continue;
+
+        replay_t replay;
+        if (replay_init(&replay, scheduler, n_cpus, &config, &memory, traces, n_traces, n_apps) < 0) {
+            perror("replay_init");
+            return EXIT_FAILURE;
+        }
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint32_t makespan_ms = replay_run(&replay);
+        double wall_s = elapsed_s(&start);
+
+        machine_t *machine = &replay.sim.machine;
+        uint64_t busy_ms = 0;
+        uint64_t switches = 0;
+        for (uint32_t i = 0; i < n_cpus; i++) {
+            busy_ms += machine->cores[i].busy_ms;
+            switches += machine->cores[i].dispatches;
+        }
+        printf("%-8s %10u %14.3f %16.3f %10.1f %10llu %10.3f %12.0f\n", scheduler->name, n_apps, makespan_ms / 1000.0,
+               replay_mean_turnaround_ms(&replay) / 1000.0,
+               makespan_ms > 0 ? 100.0 * (double) busy_ms / n_cpus / makespan_ms : 0.0,
+               (unsigned long long) switches, wall_s, wall_s > 0 ? n_apps / wall_s : 0);
+        if (n_cpus > 1) {
+            machine_print_stats(machine, makespan_ms);
+        }
+        memory_print_stats(&replay.sim.memory);
+        if (summary) {
+            metrics_print_summary(&replay.sim.metrics, machine, makespan_ms);
+            printf("\n");
+        }
+        replay_destroy(&replay);
+    }
+
+    for (uint32_t i = 0; i < n_traces; i++) {
+        free_trace(&traces[i]);
+    }
+    free(traces);
+    trace_close();
+    return EXIT_SUCCESS;
+}
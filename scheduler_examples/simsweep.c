@@ -0,0 +1,371 @@
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "replay.h"
+#include "scheduler.h"
+
+/*
+ * Parameter sweep: replays the same workloads under every combination of policy, RR quantum,
+ * memory size, page replacement and workload, in parallel. Each run owns its simulation
+ * (sim.h), so a pool of threads just takes the next run of the matrix until none is left. The results are printed in the order
+ * of the matrix, whatever the order in which the runs finished.
+ *
+ * A workload is one or more burst files joined by '+', replayed together like the files given
+ * to simbench. The quanta only apply to RR, the other policies run once per workload, and the
+ * replacement policies only apply when there are frames. The tunables that are not swept
+ * (--rr-latency, --mlfq-*, --cfs-*, --fault-ms) take a single value, used by every run.
+ *
+ * Run like: ./simsweep [--jobs N] [--scheduler <name>,...|all] [--rr-quantum MS,...]
+ *                      [--frames N,...] [--replacement <name>,...|all] [--fault-ms MS]
+ *                      [--cpus N] [--copies N] <burst-file>[+<burst-file>...]...
+ */
+
+#define MAX_LIST 64
+
+typedef struct {
+    const char *name;               // As given on the command line
+    trace_t *traces;
+    uint32_t n_traces;
+} workload_t;
+
+typedef struct {
+    // The parameters of the run
+    const scheduler_t *scheduler;
+    uint32_t quantum_ms;            // 0 when the policy has no quantum
+    memory_config_t memory;
+    const workload_t *workload;
+    // The results
+    int failed;
+    uint32_t makespan_ms;
+    double turnaround_ms;
+    double utilisation;
+    uint64_t switches;
+    uint64_t faults;
+    double wall_s;
+} sweep_run_t;
+
+typedef struct {
+    sweep_run_t *runs;
+    uint32_t n_runs;
+    atomic_uint next_run;           // Index of the next run to take
+    uint32_t n_cpus;
+    uint32_t copies;
+    scheduler_config_t config;      // The tunables that are not swept
+} sweep_t;
+
+static double elapsed_s(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Replay the workload of a run with its parameters and keep the results in the run
+ */
+static void sweep_execute(const sweep_t *sweep, sweep_run_t *run) {
+    scheduler_config_t config = sweep->config;
+    if (run->quantum_ms > 0) config.rr.quantum_ms = run->quantum_ms;
+
+    uint32_t n_apps = run->workload->n_traces * sweep->copies;
+    replay_t replay;
+    if (replay_init(&replay, run->scheduler, sweep->n_cpus, &config, &run->memory, run->workload->traces,
+                    run->workload->n_traces, n_apps) < 0) {
+        run->failed = 1;
+        return;
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run->makespan_ms = replay_run(&replay);
+    run->wall_s = elapsed_s(&start);
+    run->turnaround_ms = replay_mean_turnaround_ms(&replay);
+
+    uint64_t busy_ms = 0;
+    for (uint32_t i = 0; i < sweep->n_cpus; i++) {
+        busy_ms += replay.sim.machine.cores[i].busy_ms;
+        run->switches += replay.sim.machine.cores[i].dispatches;
+    }
+    run->faults = replay.sim.memory.faults;
+    run->utilisation = run->makespan_ms > 0 ? 100.0 * (double) busy_ms / sweep->n_cpus / run->makespan_ms : 0.0;
+    replay_destroy(&replay);
+}
+
+static void *sweep_worker(void *arg) {
+    sweep_t *sweep = arg;
+    uint32_t index;
+    while ((index = atomic_fetch_add(&sweep->next_run, 1)) < sweep->n_runs) {
+        sweep_execute(sweep, &sweep->runs[index]);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Split a comma separated list in place
+ *
+ * @return The number of items, or -1 if there are more than max
+ */
+static int split_list(char *list, char **items, int max) {
+    int count = 0;
+    for (char *item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        if (count == max) return -1;
+        items[count++] = item;
+    }
+    return count;
+}
+
+/**
+ * @brief Load the burst files of a workload, given as file[+file...]
+ */
+static int load_workload(const char *name, workload_t *workload) {
+    char *files = strdup(name);
+    if (!files) return -1;
+    workload->name = name;
+    workload->n_traces = 1;
+    for (const char *c = name; *c; c++) {
+        if (*c == '+') workload->n_traces++;
+    }
+    workload->traces = calloc(workload->n_traces, sizeof(trace_t));
+    if (!workload->traces) {
+        free(files);
+        return -1;
+    }
+    uint32_t i = 0;
+    for (char *file = strtok(files, "+"); file; file = strtok(NULL, "+")) {
+        if (load_trace(file, &workload->traces[i++]) < 0) {
+            free(files);
+            return -1;
+        }
+    }
+    workload->n_traces = i;
+    free(files);
+    return i > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    char *scheduler_list = NULL;
+    char *quantum_list = NULL;
+    char *frames_list = NULL;
+    char *replacement_list = NULL;
+    scheduler_config_t config;
+    scheduler_config_default(&config);
+    memory_config_t memory;
+    memory_config_default(&memory);
+    uint32_t copies = 1;
+    uint32_t n_cpus = 1;
+    long n_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    static const struct option long_options[] = {
+        {"scheduler", required_argument, NULL, 's'},
+        {"copies", required_argument, NULL, 'n'},
+        {"cpus", required_argument, NULL, 'p'},
+        {"jobs", required_argument, NULL, 'j'},
+        SCHEDULER_CONFIG_LONG_OPTIONS,
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:n:p:j:" SCHEDULER_CONFIG_SHORT_OPTIONS, long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                scheduler_list = optarg;
+                break;
+            // The swept tunables take lists, checked below
+            case 'q':
+                quantum_list = optarg;
+                break;
+            case 'f':
+                frames_list = optarg;
+                break;
+            case 'R':
+                replacement_list = optarg;
+                break;
+            case 'n':
+                copies = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                n_cpus = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'j':
+                n_jobs = strtol(optarg, NULL, 10);
+                break;
+            default:
+                if (scheduler_config_parse_option(&config, &memory, opt, optarg) <= 0) exit(EXIT_FAILURE);
+                break;
+        }
+    }
+    if (optind >= argc || copies == 0 || n_cpus == 0 || n_jobs < 1) {
+        printf("Usage: %s [--jobs N] [--scheduler <name>,...|all] [--rr-quantum MS,...]\n"
+               "          [--frames N,...] [--replacement <name>,...|all] [--fault-ms MS]\n"
+               "          [--rr-latency MS] [--mlfq-levels N] [--mlfq-quanta MS,MS,...] [--mlfq-boost MS]\n"
+               "          [--cfs-latency MS] [--cfs-granularity MS]\n"
+               "          [--cpus N] [--copies N] <burst-file>[+<burst-file>...]...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // The policies of the sweep
+    const scheduler_t *schedulers[MAX_LIST];
+    int n_schedulers = 0;
+    if (!scheduler_list || strcmp(scheduler_list, "all") == 0) {
+        for (int s = 0; SCHEDULERS[s] != NULL && n_schedulers < MAX_LIST; s++) {
+            schedulers[n_schedulers++] = SCHEDULERS[s];
+        }
+    } else {
+        char *names[MAX_LIST];
+        n_schedulers = split_list(scheduler_list, names, MAX_LIST);
+        for (int s = 0; s < n_schedulers; s++) {
+            schedulers[s] = get_scheduler(names[s]);
+            if (!schedulers[s]) {
+                fprintf(stderr, "Unknown scheduler: %s\n", names[s]);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    // The RR quanta, 0 for the default one
+    uint32_t quanta[MAX_LIST] = {0};
+    int n_quanta = 1;
+    if (quantum_list) {
+        char *values[MAX_LIST];
+        n_quanta = split_list(quantum_list, values, MAX_LIST);
+        for (int q = 0; q < n_quanta; q++) {
+            scheduler_config_t swept = config;
+            if (scheduler_config_parse_option(&swept, &memory, 'q', values[q]) < 0) exit(EXIT_FAILURE);
+            quanta[q] = swept.rr.quantum_ms;
+        }
+    }
+    // The memory sizes, 0 for paging off
+    uint32_t frames[MAX_LIST] = {0};
+    int n_frames = 1;
+    if (frames_list) {
+        char *values[MAX_LIST];
+        n_frames = split_list(frames_list, values, MAX_LIST);
+        for (int f = 0; f < n_frames; f++) {
+            frames[f] = (uint32_t) strtoul(values[f], NULL, 10);
+        }
+    }
+
+    // The page replacement policies
+    const replacement_t *replacements[MAX_LIST] = {&LRU_REPLACEMENT};
+    int n_replacements = 1;
+    if (replacement_list && strcmp(replacement_list, "all") == 0) {
+        for (n_replacements = 0; REPLACEMENTS[n_replacements] != NULL; n_replacements++) {
+            replacements[n_replacements] = REPLACEMENTS[n_replacements];
+        }
+    } else if (replacement_list) {
+        char *names[MAX_LIST];
+        n_replacements = split_list(replacement_list, names, MAX_LIST);
+        for (int r = 0; r < n_replacements; r++) {
+            memory_config_t swept = memory;
+            if (scheduler_config_parse_option(&config, &swept, 'R', names[r]) < 0) exit(EXIT_FAILURE);
+            replacements[r] = swept.replacement;
+        }
+    }
+    if (n_schedulers <= 0 || n_quanta <= 0 || n_frames <= 0 || n_replacements <= 0) {
+        fprintf(stderr, "At most %d values in each list\n", MAX_LIST);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t n_workloads = (uint32_t) (argc - optind);
+    workload_t *workloads = calloc(n_workloads, sizeof(workload_t));
+    if (!workloads) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t w = 0; w < n_workloads; w++) {
+        if (load_workload(argv[optind + w], &workloads[w]) < 0) {
+            fprintf(stderr, "Failed to load workload %s\n", argv[optind + w]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The matrix of runs: policy x quantum (RR only) x frames x replacement (with frames) x workload
+    sweep_t sweep = {.n_cpus = n_cpus, .copies = copies, .config = config};
+    atomic_init(&sweep.next_run, 0);
+    sweep.runs = calloc((size_t) n_schedulers * n_quanta * n_frames * n_replacements * n_workloads,
+                        sizeof(sweep_run_t));
+    if (!sweep.runs) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    const scheduler_t *rr = get_scheduler("RR");
+    for (int s = 0; s < n_schedulers; s++) {
+        int n = (schedulers[s] == rr) ? n_quanta : 1;
+        for (int q = 0; q < n; q++) {
+            for (int f = 0; f < n_frames; f++) {
+                int m = (frames[f] > 0) ? n_replacements : 1;
+                for (int r = 0; r < m; r++) {
+                    for (uint32_t w = 0; w < n_workloads; w++) {
+                        sweep.runs[sweep.n_runs++] = (sweep_run_t) {
+                            .scheduler = schedulers[s],
+                            .quantum_ms = (schedulers[s] == rr) ? quanta[q] : 0,
+                            .memory = {.frames = frames[f], .fault_ms = memory.fault_ms, .replacement = replacements[r]},
+                            .workload = &workloads[w]
+                        };
+                    }
+                }
+            }
+        }
+    }
+
+    if ((uint32_t) n_jobs > sweep.n_runs) n_jobs = sweep.n_runs;
+    pthread_t *threads = calloc((size_t) n_jobs, sizeof(pthread_t));
+    if (!threads) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long j = 0; j < n_jobs; j++) {
+        int err = pthread_create(&threads[j], NULL, sweep_worker, &sweep);
+        if (err != 0) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(err));
+            return EXIT_FAILURE;
+        }
+    }
+    for (long j = 0; j < n_jobs; j++) {
+        pthread_join(threads[j], NULL);
+    }
+    double wall_s = elapsed_s(&start);
+
+    printf("%-8s %8s %8s %-6s %-24s %8s %14s %16s %10s %10s %10s %10s\n", "Policy", "Quantum", "Frames", "Repl",
+           "Workload", "Apps", "Makespan (s)", "Turnaround (s)", "Util (%)", "Switches", "Faults", "Wall (s)");
+    int failed = 0;
+    for (uint32_t r = 0; r < sweep.n_runs; r++) {
+        const sweep_run_t *run = &sweep.runs[r];
+        char quantum[16] = "-";
+        if (run->scheduler == rr) {
+            snprintf(quantum, sizeof(quantum), "%u", run->quantum_ms ? run->quantum_ms : RR_DEFAULT_QUANTUM_MS);
+        }
+        char n_frames_text[16] = "-";
+        const char *replacement = "-";
+        if (run->memory.frames > 0) {
+            snprintf(n_frames_text, sizeof(n_frames_text), "%u", run->memory.frames);
+            replacement = run->memory.replacement->name;
+        }
+        if (run->failed) {
+            printf("%-8s %8s %8s %-6s %-24s %8s\n", run->scheduler->name, quantum, n_frames_text, replacement,
+                   run->workload->name, "failed");
+            failed = 1;
+            continue;
+        }
+        printf("%-8s %8s %8s %-6s %-24s %8u %14.3f %16.3f %10.1f %10llu %10llu %10.3f\n", run->scheduler->name,
+               quantum, n_frames_text, replacement, run->workload->name, run->workload->n_traces * copies,
+               run->makespan_ms / 1000.0, run->turnaround_ms / 1000.0, run->utilisation,
+               (unsigned long long) run->switches, (unsigned long long) run->faults, run->wall_s);
+    }
+    printf("%u runs on %ld threads in %.3f s\n", sweep.n_runs, n_jobs, wall_s);
+
+    free(threads);
+    free(sweep.runs);
+    for (uint32_t w = 0; w < n_workloads; w++) {
+        for (uint32_t i = 0; i < workloads[w].n_traces; i++) {
+            free_trace(&workloads[w].traces[i]);
+        }
+        free(workloads[w].traces);
+    }
+    free(workloads);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -3,21 +3,22 @@
 //
 #include "sjf.h"     // Header do SJF, onde declaramos a função sjf_scheduler
 
-#include <stdio.h>   // Para perror()
-#include <stdlib.h>  // Para malloc/free
-#include <unistd.h>  // Para write()
 
 #include "msg.h"     // Estruturas de mensagens usadas para comunicar com as aplicações
+#include "policy.h"  // Interface comum das políticas
 
-/**
- * @brief Shortest Job First (SJF) scheduling algorithm.
- *
- * Seleciona sempre o processo com menor tempo de execução (time_ms)
- * da fila e coloca-o a correr quando a CPU está livre.
- */
-void sjf_scheduler(uint32_t current_time_ms, queue_t *rq, pcb_t **cpu_task) {
+static uint64_t remaining_ms(const pcb_t *task) {
+    return (task->time_ms > task->ellapsed_time_ms) ? task->time_ms - task->ellapsed_time_ms : 0;
+}
 
+int sjf_enqueue(pcb_heap_t *rq, pcb_t *task) {
+    return heap_push(rq, task, remaining_ms(task));
+}
 
+/**
+ * @brief Account one tick of the running task and release the CPU if its burst is over.
+ */
+static void run_cpu_task(pcb_t **cpu_task) {
     if (*cpu_task) {
         (*cpu_task)->ellapsed_time_ms += TICKS_MS;
         /*
@@ -32,71 +33,123 @@ void sjf_scheduler(uint32_t current_time_ms, queue_t *rq, pcb_t **cpu_task) {
                 *Se ellapsed_time_ms >= time_ms, o processo terminou.
                 *
             */
-            // Task finished
-            // Send msg to application
-            msg_t msg = {
-                .pid = (*cpu_task)->pid,
-                .request = PROCESS_REQUEST_DONE,
-                .time_ms = current_time_ms
-            };
-
             /*
-                 *Envia uma mensagem para informar que o processo terminou.
-                 *msg contém: PID, tipo de requisição (PROCESS_REQUEST_DONE) e tempo atual.
-                 *write envia a mensagem via socket para o processo/aplicação.
-                 *
+                 *O PCB continua associado ao socket da aplicação, à espera do próximo pedido
+                 *(TASK_COMMAND): a simulação (run_machine) vê-o sair da CPU e envia-lhe
+                 *PROCESS_REQUEST_DONE. CPU fica livre (cpu_task = NULL).
              */
-            if (write((*cpu_task)->sockfd, &msg, sizeof(msg_t)) != sizeof(msg_t)) {
-                perror("write");
-            }
-            // Application finished and can be removed (this is FIFO after all)
-            /*
-                 *Libera a memória do processo terminado.
-                 *CPU fica livre (cpu_task = NULL).
-             */
-
-            free(*cpu_task);
+            (*cpu_task)->status = TASK_COMMAND;
             *cpu_task = NULL;
         }
     }
+}
 
+/**
+ * @brief Shortest Job First (SJF) scheduling algorithm.
+ *
+ * Seleciona sempre o processo com menor tempo de execução (time_ms)
+ * da fila e coloca-o a correr quando a CPU está livre.
+ */
+void sjf_scheduler(uint32_t current_time_ms, pcb_heap_t *rq, pcb_t **cpu_task) {
+    run_cpu_task(cpu_task);
 
     // Se a CPU está livre e a fila de prontos não está vazia, vamos selecionar o próximo processo.
-
-    if (*cpu_task == NULL && rq->head != NULL) {
-        /*
-         *Inicializa dois ponteiros para percorrer a fila
-         *curr percorre todos os elementos da fila.
-         *shortest_elem mantém o ponteiro para o processo com menor tempo de execução encontrado até agora.
-        */
-        queue_elem_t *curr = rq->head; // Nó atual da fila
-        queue_elem_t *shortest_elem = rq->head; // Começamos por assumir que o 1º é o mais curto
-
-        /*
-         * Percorre toda a fila (while) procurando o processo com menor time_ms.
-         * Cada vez que encontra um processo mais curto, atualiza shortest_elem.
-        */
-        while (curr != NULL) {
-            if (curr->pcb->time_ms < shortest_elem->pcb->time_ms) {
-                shortest_elem = curr; // Atualizar se encontrarmos um processo mais curto
-            }
-            curr = curr->next; // Avançar para o próximo nó da fila
-        }
-
-        // Agora temos o nó mais curto → remover da fila
+    if (*cpu_task == NULL) {
         /*
-         *Remove o processo mais curto da fila de prontos.
-         *remove_queue_elem retorna o nó da fila que foi removido (não libera o PCB).
+         *A fila de prontos é um min-heap: o processo mais curto está sempre na raiz,
+         *e retirá-lo custa O(log n) em vez de percorrer a fila toda.
+         *Em caso de empate, sai o que chegou primeiro.
          */
-        queue_elem_t *removed = remove_queue_elem(rq, shortest_elem);
+        *cpu_task = heap_pop(rq);
+    }
+}
 
-        /*
-         *Passa o processo mais curto para a CPU (*cpu_task).
-         *Libera apenas o nó da fila, mas não o PCB (porque ele agora está em execução).
-         */
-        if (removed) {
-            *cpu_task = removed->pcb; // Passar o processo mais curto para a CPU
-            free(removed);            // Libertar apenas o nó da fila (não o processo!)
-        }
+/**
+ * @brief Shortest Remaining Time First (SRTF) scheduling algorithm.
+ *
+ * Tal como o SJF, mas a cada tick compara o tempo em falta do processo em execução com o
+ * do processo mais curto da fila. Se este for estritamente menor, há preempção.
+ */
+void srtf_scheduler(uint32_t current_time_ms, pcb_heap_t *rq, pcb_t **cpu_task) {
+    run_cpu_task(cpu_task);
+
+    uint64_t shortest_ms;
+    if (*cpu_task && heap_peek(rq, &shortest_ms) && shortest_ms < remaining_ms(*cpu_task)) {
+        // Devolver o processo à fila, com o tempo que lhe falta
+        sjf_enqueue(rq, *cpu_task);
+        *cpu_task = NULL;
+    }
+    if (*cpu_task == NULL) {
+        *cpu_task = heap_pop(rq);
     }
-}
\ No newline at end of file
+}
+
+uint32_t srtf_ticks_to_next_event(const pcb_heap_t *rq, const pcb_t *cpu_task) {
+    // Um processo mais curto que acabou de chegar preempta o que está a correr no próximo tick
+    uint64_t shortest_ms;
+    if (heap_peek(rq, &shortest_ms) && shortest_ms < remaining_ms(cpu_task)) return 1;
+    return UINT32_MAX;
+}
+
+// Ligação à interface comum (policy.h), a fila de prontos é o heap
+
+static int sjf_rq_init(void *rq, uint32_t capacity, const scheduler_config_t *config) {
+    return heap_init(rq, capacity);
+}
+
+static void sjf_rq_destroy(void *rq) {
+    heap_destroy(rq);
+}
+
+static int sjf_rq_enqueue(void *rq, pcb_t *pcb) {
+    return sjf_enqueue(rq, pcb);
+}
+
+static pcb_t *sjf_rq_pick_next(void *rq) {
+    return heap_pop(rq);
+}
+
+static pcb_t *sjf_rq_remove(void *rq, pcb_t *pcb) {
+    return heap_remove(rq, pcb);
+}
+
+static uint32_t sjf_rq_length(const void *rq) {
+    return ((const pcb_heap_t *) rq)->size;
+}
+
+static void sjf_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    sjf_scheduler(current_time_ms, rq, cpu_task);
+}
+
+static void srtf_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    srtf_scheduler(current_time_ms, rq, cpu_task);
+}
+
+static uint32_t srtf_ticks_to_event(const void *rq, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    return srtf_ticks_to_next_event(rq, cpu_task);
+}
+
+const scheduler_t SJF_SCHEDULER = {
+    .name = "SJF",
+    .rq_size = sizeof(pcb_heap_t),
+    .init = sjf_rq_init,
+    .destroy = sjf_rq_destroy,
+    .enqueue = sjf_rq_enqueue,
+    .pick_next = sjf_rq_pick_next,
+    .remove = sjf_rq_remove,
+    .length = sjf_rq_length,
+    .tick = sjf_tick,
+};
+
+const scheduler_t SRTF_SCHEDULER = {
+    .name = "SRTF",
+    .rq_size = sizeof(pcb_heap_t),
+    .init = sjf_rq_init,
+    .destroy = sjf_rq_destroy,
+    .enqueue = sjf_rq_enqueue,
+    .pick_next = sjf_rq_pick_next,
+    .remove = sjf_rq_remove,
+    .length = sjf_rq_length,
+    .tick = srtf_tick,
+    .ticks_to_event = srtf_ticks_to_event,
+};
@@ -5,16 +5,37 @@
 #ifndef SJF_H
 #define SJF_H
 #include <stdint.h>  // Para tipos como uint32_t
-#include "queue.h"   // Para podermos usar queue_t e pcb_t
+#include "heap.h"    // Para podermos usar pcb_heap_t e pcb_t
+
+/**
+ * @brief Add a pcb to the SJF/SRTF ready queue
+ *
+ * A fila de prontos é um min-heap ordenado pelo tempo que falta (time_ms - ellapsed_time_ms),
+ * com desempate pela ordem de chegada (FIFO).
+ */
+int sjf_enqueue(pcb_heap_t *rq, pcb_t *task);
 
 /**
  * @brief Shortest Job First scheduler
  *
  * Esta função implementa o algoritmo SJF:
  * - Sempre que a CPU está livre, escolhe o processo com menor tempo total (time_ms)
- *   da fila.
+ *   da fila, em O(log n).
  * - Controla o tempo decorrido do processo em execução e envia mensagem quando termina.
  *
  */
-void sjf_scheduler(uint32_t current_time_ms, queue_t *rq, pcb_t **cpu_task);
+void sjf_scheduler(uint32_t current_time_ms, pcb_heap_t *rq, pcb_t **cpu_task);
+
+/**
+ * @brief Shortest Remaining Time First scheduler
+ *
+ * Versão preemptiva do SJF: se chegar à fila um processo com menos tempo em falta do que
+ * o processo em execução, este é preemptado e volta para a fila.
+ */
+void srtf_scheduler(uint32_t current_time_ms, pcb_heap_t *rq, pcb_t **cpu_task);
+
+/**
+ * @brief Ticks until SRTF preempts the running pcb: 1 if a shorter one is waiting, UINT32_MAX otherwise
+ */
+uint32_t srtf_ticks_to_next_event(const pcb_heap_t *rq, const pcb_t *cpu_task);
 #endif //SJF_H
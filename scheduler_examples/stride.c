@@ -0,0 +1,119 @@
+#include "stride.h"
+
+#include <stdio.h>
+
+#include "msg.h"
+#include "nice.h"
+#include "policy.h"
+
+int stride_init(stride_t *stride, uint32_t capacity) {
+    stride->pass = 0;
+    return heap_init(&stride->heap, capacity);
+}
+
+void stride_destroy(stride_t *stride) {
+    heap_destroy(&stride->heap);
+}
+
+int stride_enqueue(stride_t *stride, pcb_t *pcb) {
+    if (pcb_is_queued(pcb)) return 0;
+    // A lag behind the pass of the other core is floored below anyway, only a lead is carried
+    if (pcb->stride_home && pcb->stride_home != stride) {
+        uint64_t from = pcb->stride_home->pass;
+        pcb->stride_pass = stride->pass + ((pcb->stride_pass > from) ? pcb->stride_pass - from : 0);
+    }
+    pcb->stride_home = stride;
+    if (pcb->stride_pass < stride->pass) pcb->stride_pass = stride->pass;
+    return heap_push(&stride->heap, pcb, pcb->stride_pass);
+}
+
+/**
+ * @brief Advance the pass of a pcb that leaves the CPU by the time it ran
+ */
+static void charge(pcb_t *pcb, uint32_t current_time_ms) {
+    uint32_t ran_ticks = (current_time_ms - pcb->slice_start_ms) / TICKS_MS;
+    pcb->stride_pass += (uint64_t) ran_ticks * (STRIDE_ONE / nice_to_weight(pcb->nice));
+}
+
+uint32_t stride_ticks_to_next_event(const pcb_t *cpu_task, uint32_t current_time_ms) {
+    // The quantum ends in the tick at slice_start_ms + STRIDE_QUANTUM_MS
+    uint32_t end_ms = cpu_task->slice_start_ms + STRIDE_QUANTUM_MS;
+    return (end_ms >= current_time_ms) ? (end_ms - current_time_ms) / TICKS_MS + 1 : 1;
+}
+
+void stride_scheduler(uint32_t current_time_ms, stride_t *stride, pcb_t **cpu_task) {
+    if (*cpu_task) {
+        pcb_t *task = *cpu_task;
+        task->ellapsed_time_ms += TICKS_MS;
+
+        if (task->ellapsed_time_ms >= task->time_ms) {
+            // Burst finished: the pcb keeps its pass and waits for the next command
+            charge(task, current_time_ms);
+            task->status = TASK_COMMAND;
+            *cpu_task = NULL;
+        } else if (current_time_ms - task->slice_start_ms >= STRIDE_QUANTUM_MS) {
+            // Quantum over: back to the heap, it runs again right away if its pass is still the smallest
+            charge(task, current_time_ms);
+            stride_enqueue(stride, task);
+            *cpu_task = NULL;
+        }
+    }
+
+    if (*cpu_task == NULL) {
+        *cpu_task = heap_pop(&stride->heap);
+        if (*cpu_task) {
+            stride->pass = (*cpu_task)->stride_pass;
+            (*cpu_task)->slice_start_ms = current_time_ms;
+        }
+    }
+}
+
+static int stride_rq_init(void *rq, uint32_t capacity, const scheduler_config_t *config) {
+    return stride_init(rq, capacity);
+}
+
+static void stride_rq_destroy(void *rq) {
+    stride_destroy(rq);
+}
+
+static int stride_rq_enqueue(void *rq, pcb_t *pcb) {
+    return stride_enqueue(rq, pcb);
+}
+
+static pcb_t *stride_rq_pick_next(void *rq) {
+    return heap_pop(&((stride_t *) rq)->heap);
+}
+
+static pcb_t *stride_rq_remove(void *rq, pcb_t *pcb) {
+    return heap_remove(&((stride_t *) rq)->heap, pcb);
+}
+
+static uint32_t stride_rq_length(const void *rq) {
+    return ((const stride_t *) rq)->heap.size;
+}
+
+static void stride_tick(uint32_t current_time_ms, void *rq, pcb_t **cpu_task) {
+    stride_scheduler(current_time_ms, rq, cpu_task);
+}
+
+static uint32_t stride_ticks_to_event(const void *rq, const pcb_t *cpu_task, uint32_t current_time_ms) {
+    return stride_ticks_to_next_event(cpu_task, current_time_ms);
+}
+
+static void stride_print_stats(const void *rq) {
+    printf("  STRIDE: pass %llu\n", (unsigned long long) ((const stride_t *) rq)->pass);
+}
+
+const scheduler_t STRIDE_SCHEDULER = {
+    .name = "STRIDE",
+    .rq_size = sizeof(stride_t),
+    .init = stride_rq_init,
+    .destroy = stride_rq_destroy,
+    .enqueue = stride_rq_enqueue,
+    .pick_next = stride_rq_pick_next,
+    .remove = stride_rq_remove,
+    .length = stride_rq_length,
+    .tick = stride_tick,
+    .ticks_to_event = stride_ticks_to_event,
+    .print_stats = stride_print_stats,
+};
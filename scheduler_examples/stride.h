@@ -0,0 +1,57 @@
+#ifndef STRIDE_H
+#define STRIDE_H
+
+#include <stdint.h>
+
+#include "heap.h"
+
+#define STRIDE_QUANTUM_MS 100
+#define STRIDE_ONE (1u << 20)       // Stride of a pcb of weight 1
+
+// The stride ready queue: a min-heap of the pcbs keyed by their pass
+typedef struct stride_st {
+    pcb_heap_t heap;
+    uint64_t pass;                  // Pass of the last dispatched pcb, the virtual time of the queue
+} stride_t;
+
+/**
+ * @brief Initialize an empty stride ready queue
+ *
+ * @param capacity The expected number of pcbs, to size the heap
+ * @return 0 on success, -1 on failure
+ */
+int stride_init(stride_t *stride, uint32_t capacity);
+
+/**
+ * @brief Release the memory of a stride ready queue (the pcbs are not freed)
+ */
+void stride_destroy(stride_t *stride);
+
+/**
+ * @brief Add a pcb to the stride ready queue in O(log n)
+ *
+ * A pcb that was away (blocked or waiting for a command) does not keep the pass it had: it
+ * starts no earlier than the virtual time of the queue, so it cannot make up for the time it
+ * did not ask for the CPU. Every core has its own virtual time, so a pcb that comes from
+ * another core first keeps its lead over the pass of that core, measured against this one.
+ */
+int stride_enqueue(stride_t *stride, pcb_t *pcb);
+
+/**
+ * @brief Number of ticks until the running pcb uses up its quantum, at least 1
+ *
+ * @param current_time_ms The time of the next tick
+ */
+uint32_t stride_ticks_to_next_event(const pcb_t *cpu_task, uint32_t current_time_ms);
+
+/**
+ * @brief Stride scheduling algorithm
+ *
+ * Every pcb has a stride inversely proportional to the weight of its nice value, and a pass
+ * that advances by its stride for every tick it runs. The CPU runs the pcb with the smallest
+ * pass for a quantum of STRIDE_QUANTUM_MS, so over time each pcb gets a share of the CPU
+ * proportional to its weight. Picking the next pcb costs O(log n).
+ */
+void stride_scheduler(uint32_t current_time_ms, stride_t *stride, pcb_t **cpu_task);
+
+#endif //STRIDE_H
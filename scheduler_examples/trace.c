@@ -0,0 +1,68 @@
+#include "trace.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const char *TRACE_EVENT_NAMES[] = {
+    "RUN",
+    "BLOCK",
+    "ACK",
+    "DISPATCH",
+    "PREEMPT",
+    "DONE",
+    "UNBLOCK"
+};
+
+// The trace being recorded, NULL if none
+static trace_header_t *trace_header = NULL;
+static trace_record_t *trace_records = NULL;
+static size_t trace_size = 0;
+static uint64_t trace_mask = 0;     // capacity - 1, the capacity is a power of two
+
+int trace_open(const char *path, uint64_t capacity) {
+    uint64_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+    capacity = rounded;
+    size_t size = sizeof(trace_header_t) + capacity * sizeof(trace_record_t);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t) size) < 0) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping keeps the file
+    if (map == MAP_FAILED) return -1;
+
+    trace_header = map;
+    memcpy(trace_header->magic, TRACE_MAGIC, sizeof(trace_header->magic));
+    trace_header->version = TRACE_VERSION;
+    trace_header->record_size = sizeof(trace_record_t);
+    trace_header->capacity = capacity;
+    trace_header->head = 0;
+    trace_records = (trace_record_t *) (trace_header + 1);
+    trace_size = size;
+    trace_mask = capacity - 1;
+    return 0;
+}
+
+void trace_close(void) {
+    if (!trace_header) return;
+    munmap(trace_header, trace_size);
+    trace_header = NULL;
+    trace_records = NULL;
+    trace_size = 0;
+}
+
+void trace_event(trace_event_en event, const pcb_t *pcb, uint16_t cpu, uint32_t current_time_ms) {
+    if (!trace_header) return;
+    trace_records[trace_header->head & trace_mask] = (trace_record_t) {
+        .time_ms = current_time_ms,
+        .pid = pcb->pid,
+        .cpu = cpu,
+        .event = (uint16_t) event
+    };
+    trace_header->head++;
+}
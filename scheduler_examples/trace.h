@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "queue.h"
+
+/*
+ * Binary event trace. Fixed-size records are appended to a ring buffer that is a
+ * memory-mapped file, so recording an event is a couple of stores and the file is
+ * readable even if the simulator is killed. The ring keeps the last `capacity` events.
+ * trace2json converts a trace into the Chrome trace format (chrome://tracing, Perfetto).
+ *
+ * File layout: a trace_header_t followed by `capacity` trace_record_t.
+ */
+
+#define TRACE_MAGIC "OSSIMTRC"
+#define TRACE_VERSION 1
+#define TRACE_DEFAULT_CAPACITY (1u << 20)   // Records, 12 MB
+#define TRACE_NO_CPU UINT16_MAX             // cpu of the events that do not happen on a core
+
+typedef enum {
+    TRACE_RUN = 0,      // RUN request, the pcb entered a ready queue
+    TRACE_BLOCK,        // BLOCK request, the pcb entered the blocked queue
+    TRACE_ACK,          // ACK sent to the application
+    TRACE_DISPATCH,     // The pcb started running on a core
+    TRACE_PREEMPT,      // The pcb left the core before the end of its burst
+    TRACE_DONE,         // The burst ended, DONE sent to the application
+    TRACE_UNBLOCK,      // The block ended, DONE sent to the application
+    TRACE_EVENT_COUNT
+} trace_event_en;
+
+typedef struct {
+    char magic[8];          // TRACE_MAGIC, without the terminator
+    uint32_t version;       // TRACE_VERSION
+    uint32_t record_size;   // sizeof(trace_record_t)
+    uint64_t capacity;      // Number of records in the ring
+    uint64_t head;          // Number of records written so far, the next one goes to head % capacity
+} trace_header_t;
+
+typedef struct {
+    uint32_t time_ms;       // Simulated time of the event
+    int32_t pid;
+    uint16_t cpu;           // Core of the event, TRACE_NO_CPU if none
+    uint16_t event;         // trace_event_en
+} trace_record_t;
+
+// Names of the events, indexed by trace_event_en
+extern const char *TRACE_EVENT_NAMES[];
+
+/**
+ * @brief Create a trace file and start recording to it
+ *
+ * @param path The file, truncated if it exists
+ * @param capacity The number of records of the ring, rounded up to a power of two
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int trace_open(const char *path, uint64_t capacity);
+
+/**
+ * @brief Stop recording and unmap the trace file
+ */
+void trace_close(void);
+
+/**
+ * @brief Record an event, does nothing if no trace is open
+ */
+void trace_event(trace_event_en event, const pcb_t *pcb, uint16_t cpu, uint32_t current_time_ms);
+
+#endif //TRACE_H
@@ -0,0 +1,244 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/*
+ * Convert a binary trace written by the simulator (--trace) into the Chrome trace
+ * JSON format, to be opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Two groups of tracks are produced:
+ * - "CPUs": one track per core, with a slice for every time a process ran on it.
+ * - "Processes": one track per process, with its running, ready and blocked periods
+ *   and the ACKs it received.
+ */
+
+#define TRACK_CPUS 1
+#define TRACK_PROCESSES 2
+#define NO_TIME UINT32_MAX
+
+// What a process is doing, rebuilt from the events
+typedef struct {
+    int32_t pid;
+    int used;
+    uint32_t ready_since_ms;
+    uint32_t running_since_ms;
+    uint32_t blocked_since_ms;
+    uint16_t cpu;
+} process_state_t;
+
+// Open addressing hash table of the processes, indexed by pid
+static process_state_t *processes = NULL;
+static uint32_t processes_capacity = 0;
+static uint32_t processes_count = 0;
+
+static FILE *out;
+static int first_event = 1;
+
+static uint32_t hash_pid(int32_t pid) {
+    return (uint32_t) pid * 2654435761u;
+}
+
+static process_state_t *find_slot(process_state_t *table, uint32_t capacity, int32_t pid) {
+    uint32_t i = hash_pid(pid) & (capacity - 1);
+    while (table[i].used && table[i].pid != pid) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &table[i];
+}
+
+static void grow_processes(void) {
+    uint32_t capacity = processes_capacity ? processes_capacity * 2 : 1024;
+    process_state_t *table = calloc(capacity, sizeof(process_state_t));
+    if (!table) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < processes_capacity; i++) {
+        if (processes[i].used) {
+            *find_slot(table, capacity, processes[i].pid) = processes[i];
+        }
+    }
+    free(processes);
+    processes = table;
+    processes_capacity = capacity;
+}
+
+static void begin_event(void) {
+    fputs(first_event ? "\n" : ",\n", out);
+    first_event = 0;
+}
+
+static void emit_slice(int track, int32_t tid, const char *name, const char *category,
+                       uint32_t start_ms, uint32_t end_ms) {
+    begin_event();
+    fprintf(out, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%d}",
+            name, category, (unsigned long long) start_ms * 1000, (unsigned long long) (end_ms - start_ms) * 1000,
+            track, tid);
+}
+
+static void emit_name(const char *kind, int track, int32_t tid, const char *name) {
+    begin_event();
+    fprintf(out, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            kind, track, tid, name);
+}
+
+static process_state_t *get_process(int32_t pid) {
+    if ((processes_count + 1) * 4 > processes_capacity * 3) {
+        grow_processes();
+    }
+    process_state_t *p = find_slot(processes, processes_capacity, pid);
+    if (!p->used) {
+        *p = (process_state_t) {
+            .pid = pid,
+            .used = 1,
+            .ready_since_ms = NO_TIME,
+            .running_since_ms = NO_TIME,
+            .blocked_since_ms = NO_TIME
+        };
+        processes_count++;
+        char name[32];
+        snprintf(name, sizeof(name), "PID %d", pid);
+        emit_name("thread_name", TRACK_PROCESSES, pid, name);
+    }
+    return p;
+}
+
+static void end_running(process_state_t *p, uint32_t time_ms) {
+    if (p->running_since_ms == NO_TIME) return;
+    char name[32];
+    snprintf(name, sizeof(name), "PID %d", p->pid);
+    emit_slice(TRACK_CPUS, p->cpu, name, "running", p->running_since_ms, time_ms);
+    emit_slice(TRACK_PROCESSES, p->pid, "running", "running", p->running_since_ms, time_ms);
+    p->running_since_ms = NO_TIME;
+}
+
+static void end_ready(process_state_t *p, uint32_t time_ms) {
+    if (p->ready_since_ms == NO_TIME) return;
+    emit_slice(TRACK_PROCESSES, p->pid, "ready", "ready", p->ready_since_ms, time_ms);
+    p->ready_since_ms = NO_TIME;
+}
+
+static void end_blocked(process_state_t *p, uint32_t time_ms) {
+    if (p->blocked_since_ms == NO_TIME) return;
+    emit_slice(TRACK_PROCESSES, p->pid, "blocked", "blocked", p->blocked_since_ms, time_ms);
+    p->blocked_since_ms = NO_TIME;
+}
+
+/**
+ * @brief Turn one record into slices, closing the period it ends and opening the one it starts
+ */
+static void convert_record(const trace_record_t *r, uint32_t *max_cpu) {
+    process_state_t *p = get_process(r->pid);
+    switch (r->event) {
+        case TRACE_RUN:
+            p->ready_since_ms = r->time_ms;
+            break;
+        case TRACE_BLOCK:
+            p->blocked_since_ms = r->time_ms;
+            break;
+        case TRACE_ACK:
+            begin_event();
+            fprintf(out, "{\"name\":\"ACK\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":%d,\"tid\":%d}",
+                    (unsigned long long) r->time_ms * 1000, TRACK_PROCESSES, r->pid);
+            break;
+        case TRACE_DISPATCH:
+            end_ready(p, r->time_ms);
+            p->running_since_ms = r->time_ms;
+            p->cpu = r->cpu;
+            if (r->cpu != TRACE_NO_CPU && (*max_cpu == UINT32_MAX || r->cpu > *max_cpu)) *max_cpu = r->cpu;
+            break;
+        case TRACE_PREEMPT:
+            end_running(p, r->time_ms);
+            p->ready_since_ms = r->time_ms;
+            break;
+        case TRACE_DONE:
+            end_running(p, r->time_ms);
+            break;
+        case TRACE_UNBLOCK:
+            end_blocked(p, r->time_ms);
+            break;
+        default:
+            fprintf(stderr, "Unknown event %u at %u ms\n", r->event, r->time_ms);
+            break;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        printf("Usage: %s <trace-file> [output.json]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(trace_header_t)) {
+        fprintf(stderr, "%s: not a trace file\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    const void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+    const trace_header_t *header = map;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || header->version != TRACE_VERSION ||
+        header->record_size != sizeof(trace_record_t) ||
+        (size_t) st.st_size < sizeof(trace_header_t) + header->capacity * sizeof(trace_record_t)) {
+        fprintf(stderr, "%s: not a trace file of version %d\n", argv[1], TRACE_VERSION);
+        return EXIT_FAILURE;
+    }
+    const trace_record_t *records = (const trace_record_t *) (header + 1);
+
+    out = stdout;
+    if (argc == 3 && (out = fopen(argv[2], "w")) == NULL) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    // Once the ring wrapped, only the last `capacity` records are left
+    uint64_t first = (header->head > header->capacity) ? header->head - header->capacity : 0;
+    if (first > 0) {
+        fprintf(stderr, "The ring wrapped, the first %llu events were lost\n", (unsigned long long) first);
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+    emit_name("process_name", TRACK_CPUS, 0, "CPUs");
+    emit_name("process_name", TRACK_PROCESSES, 0, "Processes");
+    uint32_t max_cpu = UINT32_MAX;
+    uint32_t last_time_ms = 0;
+    for (uint64_t i = first; i < header->head; i++) {
+        const trace_record_t *r = &records[i & (header->capacity - 1)];
+        convert_record(r, &max_cpu);
+        last_time_ms = r->time_ms;
+    }
+
+    // Close what was still going on when the trace ended
+    for (uint32_t i = 0; i < processes_capacity; i++) {
+        if (!processes[i].used) continue;
+        end_running(&processes[i], last_time_ms);
+        end_ready(&processes[i], last_time_ms);
+        end_blocked(&processes[i], last_time_ms);
+    }
+    for (uint32_t cpu = 0; max_cpu != UINT32_MAX && cpu <= max_cpu; cpu++) {
+        char name[32];
+        snprintf(name, sizeof(name), "CPU %u", cpu);
+        emit_name("thread_name", TRACK_CPUS, (int32_t) cpu, name);
+    }
+    fputs("\n]}\n", out);
+
+    fprintf(stderr, "%llu events of %u processes converted\n",
+            (unsigned long long) (header->head - first), processes_count);
+    if (out != stdout) fclose(out);
+    free(processes);
+    munmap((void *) map, (size_t) st.st_size);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,8 @@
+# Workload for loadgen, see loadgen.c
+processes = 500
+arrival = poisson 20        # Applications per simulated second
+bursts = uniform 2 8        # Bursts per application
+cpu = exponential 40        # ms
+io = exponential 200        # ms
+nice = 0:80 -5:10 10:10
+seed = 42